@@ -0,0 +1,291 @@
+/* midiqueue - stress test xjadeo's jack-midi event queue
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "midi_queue.h"
+
+/* A producer thread mimics jack_midi_process() receiving MTC at 25fps:
+ * every process cycle (4096 frames) carries the 8 quarter-frame
+ * messages (0xF1) for the next two video frames, every 25th cycle is
+ * preceded by a full-frame SysEx (F0 7F 7F 01 01 hh mm ss ff F7).
+ * Cycle `c` sends timecode frame 2 * c, and publishes `c` before and
+ * after it calls jmq_cycle().
+ *
+ * The consumer drains the queue like dequeue_jmidi_events(): events
+ * of previous cycles are always processed, events of the current
+ * cycle only up to `until`, which is picked at random for each poll.
+ * It stalls now and then, so that the queue overflows.
+ *
+ * Checked:
+ *  - the MTC stream decodes: quarter-frame pieces arrive in order and
+ *    intact, decoded timecode increases.
+ *  - no event of the current cycle is processed when its time is past
+ *    `until`: events of the latest cycle that had started when
+ *    jmq_peek() returned are current.
+ *  - no event of a previous cycle is held back: the cycle that had
+ *    started before jmq_peek() was called is current, or later.
+ *  - every event is either received or counted as overflow.
+ */
+
+#define NFRAMES (4096)        // samples per process cycle
+#define QF_TIME(p) (64 + 480 * (p)) // 25fps at 48kHz: 480 samples per quarter-frame
+#define SYX_TIME (32)
+#define SYX_EVERY (25)        // cycles
+#define FPS (25)
+
+static jm_queue_t queue;
+static volatile int producer_done = 0;
+static unsigned long cycle_begin = 0; ///< set before jmq_cycle()
+static unsigned long cycle_now = 0;   ///< set after jmq_cycle()
+static unsigned long cycles = 50000;
+static unsigned long produced = 0;
+static unsigned long rejected = 0;
+
+static void tc_split (unsigned long frame, int *hh, int *mm, int *ss, int *ff) {
+	*ff = frame % FPS;
+	*ss = (frame / FPS) % 60;
+	*mm = (frame / (FPS * 60)) % 60;
+	*hh = (frame / (FPS * 3600)) % 24;
+}
+
+static void push (uint32_t time, const uint8_t *data, size_t size) {
+	if (jmq_push (&queue, time, data, size)) {
+		++rejected;
+	}
+	++produced;
+}
+
+static void *producer (void *arg) {
+	unsigned long c;
+	int p, hh, mm, ss, ff;
+	for (c = 1; c <= cycles; ++c) {
+		__atomic_store_n (&cycle_begin, c, __ATOMIC_RELAXED);
+		// pairs with the fence after jmq_peek(), which reads `cycle`
+		__atomic_thread_fence (__ATOMIC_RELEASE);
+		jmq_cycle (&queue);
+		__atomic_store_n (&cycle_now, c, __ATOMIC_RELEASE);
+
+		tc_split (2 * c, &hh, &mm, &ss, &ff);
+		if ((c % SYX_EVERY) == 0) {
+			const uint8_t syx[10] = { 0xf0, 0x7f, 0x7f, 0x01, 0x01, (1 << 5) | hh, mm, ss, ff, 0xf7 };
+			push (SYX_TIME, syx, sizeof (syx));
+		}
+		const int nibble[8] = {
+			ff & 0xf, ff >> 4, ss & 0xf, ss >> 4,
+			mm & 0xf, mm >> 4, hh & 0xf, (hh >> 4) | (1 << 1)
+		};
+		for (p = 0; p < 8; ++p) {
+			const uint8_t qf[2] = { 0xf1, (p << 4) | nibble[p] };
+			push (QF_TIME(p), qf, sizeof (qf));
+		}
+		usleep (100); // process cycle period
+	}
+	__atomic_store_n (&producer_done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* consumer state */
+
+static unsigned long received = 0;
+static unsigned long held = 0;       ///< polls that stopped at a current-cycle event
+static unsigned long groups = 0;     ///< complete quarter-frame sequences
+static unsigned long fullframes = 0;
+static unsigned long corrupt = 0;
+static unsigned long reordered = 0;
+static unsigned long early = 0;
+static unsigned long stale = 0;
+
+static unsigned long last_qf = 0, last_syx = 0; // cycle
+static unsigned long hold_cycle = 0;
+
+/* per quarter-frame piece: the cycle begun at jmq_peek(), if it was
+ * processed after `until`, and the cycle read before jmq_peek() in the
+ * polls that held it back. The cycle of the event is only known once
+ * the sequence is complete.
+ */
+static unsigned long qf_late[8];
+static unsigned long qf_hold[8];
+static int qf_nibble[8];
+static int qf_next = 0;
+
+static void check_cycle (unsigned long c, unsigned long late, unsigned long hold) {
+	if (late && c >= late) {
+		++early;
+	}
+	if (hold && c < hold) {
+		++stale;
+	}
+}
+
+static void decode (const my_midi_event_t *ev, unsigned long late, unsigned long hold) {
+	if (ev->size == 2 && ev->buffer[0] == 0xf1) {
+		const int p = ev->buffer[1] >> 4;
+		int i;
+		if (ev->time != QF_TIME(p)) {
+			++corrupt;
+			qf_next = 0;
+			return;
+		}
+		if (p != qf_next) {
+			// a gap, the queue overflowed. Wait for the next sequence.
+			qf_next = 0;
+			return;
+		}
+		qf_nibble[p] = ev->buffer[1] & 0xf;
+		qf_late[p] = late;
+		qf_hold[p] = hold;
+		if (++qf_next < 8) {
+			return;
+		}
+		qf_next = 0;
+
+		const unsigned long frame =
+			  (qf_nibble[0] | (qf_nibble[1] << 4))
+			+ (qf_nibble[2] | (qf_nibble[3] << 4)) * FPS
+			+ (qf_nibble[4] | (qf_nibble[5] << 4)) * FPS * 60
+			+ (qf_nibble[6] | ((qf_nibble[7] & 1) << 4)) * FPS * 3600;
+		const unsigned long c = frame / 2;
+		if ((frame & 1) || (qf_nibble[7] >> 1) != 1) {
+			++corrupt;
+			return;
+		}
+		if (c <= last_qf || c < last_syx) {
+			++reordered;
+		}
+		last_qf = c;
+		for (i = 0; i < 8; ++i) {
+			check_cycle (c, qf_late[i], qf_hold[i]);
+		}
+		++groups;
+	}
+	else if (ev->size == 10 && ev->buffer[0] == 0xf0) {
+		const uint8_t *b = ev->buffer;
+		if (ev->time != SYX_TIME || b[1] != 0x7f || b[2] != 0x7f || b[3] != 0x01 || b[4] != 0x01
+				|| (b[5] >> 5) != 1 || b[9] != 0xf7) {
+			++corrupt;
+			return;
+		}
+		const unsigned long frame = b[8] + b[7] * FPS + b[6] * FPS * 60 + (b[5] & 0x1f) * FPS * 3600;
+		const unsigned long c = frame / 2;
+		if (c <= last_syx || c <= last_qf) {
+			++reordered;
+		}
+		last_syx = c;
+		check_cycle (c, late, hold);
+		++fullframes;
+	}
+	else {
+		++corrupt;
+	}
+}
+
+/* same as dequeue_jmidi_events() in src/xjadeo/midi.c */
+static void dequeue (uint32_t until) {
+	unsigned int rd, ci;
+	const unsigned long before = __atomic_load_n (&cycle_now, __ATOMIC_ACQUIRE);
+	const unsigned int end = jmq_peek (&queue, &rd, &ci);
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	const unsigned long after = __atomic_load_n (&cycle_begin, __ATOMIC_RELAXED);
+
+	while (rd != end) {
+		my_midi_event_t *ev = jmq_event (&queue, rd);
+		// always process data from prev. jack cycles.
+		if ((int)(rd - ci) >= 0 && ev->time > until) {
+			hold_cycle = before;
+			++held;
+			break;
+		}
+		decode (ev, ev->time > until ? after : 0, hold_cycle);
+		hold_cycle = 0;
+		++received;
+		++rd;
+	}
+	jmq_release (&queue, rd);
+}
+
+int main (int argc, char **argv) {
+	pthread_t thread;
+	unsigned long polls = 0;
+	int rv = 0;
+
+	if (argc > 1) {
+		cycles = strtoul (argv[1], NULL, 10);
+	}
+	if (cycles < 1 || cycles > 1000000) { // timecode wraps after 24h
+		fprintf (stderr, "usage: %s [number of cycles, 1..1000000]\n", argv[0]);
+		return 1;
+	}
+
+	if (pthread_create (&thread, NULL, producer, NULL)) {
+		fprintf (stderr, "cannot create producer thread\n");
+		return 1;
+	}
+
+	for (;;) {
+		const int done = __atomic_load_n (&producer_done, __ATOMIC_ACQUIRE);
+		if (done) {
+			dequeue (UINT32_MAX);
+			break;
+		}
+		dequeue (rand () % NFRAMES);
+		if ((++polls % 2000) == 0) {
+			// fall behind, let the queue fill up
+			usleep (30000);
+		} else {
+			usleep (50);
+		}
+	}
+	pthread_join (thread, NULL);
+
+	const unsigned int overflow = jmq_overflow (&queue);
+	printf ("produced: %lu received: %lu overflow: %u\n", produced, received, overflow);
+	printf ("quarter-frame sequences: %lu full-frame: %lu polls held at a current-cycle event: %lu\n",
+			groups, fullframes, held);
+
+	if (received + overflow != produced) {
+		fprintf (stderr, "FAIL: %lu events lost\n", produced - received - overflow);
+		rv = 1;
+	}
+	if (overflow != rejected) {
+		fprintf (stderr, "FAIL: overflow count %u, but %lu events were rejected\n", overflow, rejected);
+		rv = 1;
+	}
+	if (reordered || corrupt) {
+		fprintf (stderr, "FAIL: %lu events out of order, %lu corrupt\n", reordered, corrupt);
+		rv = 1;
+	}
+	if (early) {
+		fprintf (stderr, "FAIL: %lu current-cycle events processed before `until`\n", early);
+		rv = 1;
+	}
+	if (stale) {
+		fprintf (stderr, "FAIL: %lu events of a previous cycle were held back\n", stale);
+		rv = 1;
+	}
+	if (overflow == 0) {
+		printf ("note: the queue did not overflow, the overflow path was not exercised\n");
+	}
+	if (held == 0) {
+		printf ("note: no event was held back, the `until` cut-off was not exercised\n");
+	}
+	return rv;
+}
@@ -0,0 +1,233 @@
+/* osdbench - compare xjadeo's OSD span kernels with per-pixel rendering
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int movie_width, movie_height;
+
+#include "display_osd.h"
+
+/* the per-pixel functions that display.c used before the span kernels */
+
+typedef struct {
+	size_t Uoff;
+	size_t Voff;
+	int bpp;
+} rendervars;
+
+typedef void (*osd_pixel) (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val);
+
+static void _old_overlay_YUV422 (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int yoff = (2 * dx + movie_width * dy * 2);
+	mybuffer[yoff+1] = 0xff - ((mybuffer[yoff+1] >> 1) + (val >> 1));
+	mybuffer[yoff+3] = 0xff - ((mybuffer[yoff+3] >> 1) + (val >> 1));
+}
+
+static void _old_overlay_YUV (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int yoff = (dx + movie_width * dy);
+	mybuffer[yoff] = 0xff - ((mybuffer[yoff] >> 1)  + (val >> 1));
+}
+
+static void _old_overlay_RGB (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int pos = rv->bpp * (dx + movie_width * dy);
+	mybuffer[pos]  = 0xff - ((mybuffer[pos]   >> 1) + (val >> 1));
+	mybuffer[pos+1]= 0xff - ((mybuffer[pos+1] >> 1) + (val >> 1));
+	mybuffer[pos+2]= 0xff - ((mybuffer[pos+2] >> 1) + (val >> 1));
+}
+
+static void _old_render_YUV422 (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int yoff = 2 * dx + movie_width * dy * 2;
+	mybuffer[yoff+0] = 0x80;
+	mybuffer[yoff+1] = val;
+	mybuffer[yoff+2] = 0x80;
+	mybuffer[yoff+3] = val;
+}
+
+static void _old_render_YUV (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int yoff = (dx + movie_width * dy);
+	const int uvoff = (dx / 2) + movie_width / 2 * (dy / 2);
+	mybuffer[yoff] = val;
+	mybuffer[rv->Uoff+uvoff] = 0x80;
+	mybuffer[rv->Voff+uvoff] = 0x80;
+}
+
+static void _old_render_RGB (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
+	const int pos = rv->bpp * (dx + movie_width * dy);
+	mybuffer[pos] = val;
+	mybuffer[pos+1] = val;
+	mybuffer[pos+2] = val;
+}
+
+/* test setup */
+
+typedef struct {
+	const char *name;
+	int bpp;     ///< bytes per pixel, 0: YUV420P
+	osd_pixel old_render;
+	osd_pixel old_overlay;
+	const osd_kernels *k;
+} Format;
+
+static const Format formats[] = {
+	{ "YUV420P", 0, &_old_render_YUV,    &_old_overlay_YUV,    &osd_YUV },
+	{ "UYVY422", 2, &_old_render_YUV422, &_old_overlay_YUV422, &osd_YUV422 },
+	{ "RGB24",   3, &_old_render_RGB,    &_old_overlay_RGB,    &osd_RGB3 },
+	{ "BGRA32",  4, &_old_render_RGB,    &_old_overlay_RGB,    &osd_RGB4 },
+};
+
+static const int sizes[][2] = {
+	{ 1920, 1080 },
+	{ 3840, 2160 },
+};
+
+/* a text-like band: a w * h image at (x0, y0), drawn as
+ * OSD_render() does, values below `min` are skipped.
+ */
+typedef struct {
+	const char *name;
+	int overlay;
+	uint8_t min;
+	int x0, y0, w, h;
+	uint8_t *img;
+} Workload;
+
+static size_t buffer_size (const Format *f) {
+	if (f->bpp == 0) {
+		return (size_t)movie_width * movie_height * 3 / 2;
+	}
+	return (size_t)movie_width * movie_height * f->bpp;
+}
+
+static void draw_old (const Format *f, const Workload *w, uint8_t *buf) {
+	rendervars rv;
+	osd_pixel fn = w->overlay ? f->old_overlay : f->old_render;
+	int x, y;
+	rv.Uoff = movie_width * movie_height;
+	rv.Voff = rv.Uoff + movie_width * movie_height / 4;
+	rv.bpp  = f->bpp;
+	for (y = 0; y < w->h; ++y) {
+		for (x = 0; x < w->w; ++x) {
+			const uint8_t v = w->img[y * w->w + x];
+			if (v >= w->min)
+				fn (buf, &rv, x + w->x0, y + w->y0, v);
+		}
+	}
+}
+
+static void draw_new (const Format *f, const Workload *w, uint8_t *buf) {
+	osd_span fn = w->overlay ? f->k->overlay : f->k->render;
+	int y;
+	for (y = 0; y < w->h; ++y) {
+		fn (buf, w->x0, y + w->y0, &w->img[y * w->w], w->w, w->min);
+	}
+}
+
+static double now (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* average time per call in usec */
+static double bench (void (*draw)(const Format*, const Workload*, uint8_t*),
+		const Format *f, const Workload *w, uint8_t *buf) {
+	int n = 0;
+	double t0 = now ();
+	double t1 = t0;
+	while (t1 - t0 < .25 || n < 10) {
+		draw (f, w, buf);
+		++n;
+		t1 = now ();
+	}
+	return 1e6 * (t1 - t0) / n;
+}
+
+int main (int argc, char **argv) {
+	unsigned int s, i, j;
+	int rv = 0;
+
+	srand (1);
+	printf ("%-8s %-10s %-14s %10s %10s %8s\n", "size", "format", "workload", "old [us]", "new [us]", "speedup");
+
+	for (s = 0; s < sizeof (sizes) / sizeof (sizes[0]); ++s) {
+		movie_width  = sizes[s][0];
+		movie_height = sizes[s][1];
+
+		/* text at the bottom of the frame, a progress-bar and a
+		 * blended box with an odd, unaligned start column */
+		Workload work[] = {
+			{ "text",        0, 0x01, movie_width / 8 + 1, movie_height * 8 / 10, movie_width * 3 / 4, movie_height / 12, NULL },
+			{ "text-box",    0, 0x00, movie_width / 8 + 1, movie_height * 8 / 10, movie_width * 3 / 4, movie_height / 12, NULL },
+			{ "bar",         1, 0x00, 15,                  movie_height / 10,     movie_width - 30,    movie_height / 20, NULL },
+			{ "overlay-min", 1, 0x40, movie_width / 4 + 3, movie_height / 3,      movie_width / 2,     movie_height / 3,  NULL },
+		};
+
+		for (j = 0; j < sizeof (work) / sizeof (work[0]); ++j) {
+			Workload *w = &work[j];
+			int k;
+			w->img = malloc ((size_t)w->w * w->h);
+			for (k = 0; k < w->w * w->h; ++k) {
+				const int x = k % w->w;
+				if (w->overlay && w->min == 0) {
+					w->img[k] = (x % 9) ? 0xf0 : 0x20; // bars'n'stripes
+				} else {
+					w->img[k] = (rand () & 1) ? rand () & 0xff : 0;
+				}
+			}
+		}
+
+		for (i = 0; i < sizeof (formats) / sizeof (formats[0]); ++i) {
+			const Format *f = &formats[i];
+			const size_t bs = buffer_size (f);
+			uint8_t *ref = malloc (bs);
+			uint8_t *b0  = malloc (bs);
+			uint8_t *b1  = malloc (bs);
+			size_t k;
+			for (k = 0; k < bs; ++k) {
+				ref[k] = rand () & 0xff;
+			}
+
+			for (j = 0; j < sizeof (work) / sizeof (work[0]); ++j) {
+				const Workload *w = &work[j];
+				memcpy (b0, ref, bs);
+				memcpy (b1, ref, bs);
+				draw_old (f, w, b0);
+				draw_new (f, w, b1);
+				if (memcmp (b0, b1, bs)) {
+					fprintf (stderr, "MISMATCH: %dx%d %s %s\n", movie_width, movie_height, f->name, w->name);
+					rv = 1;
+				}
+
+				const double t_old = bench (&draw_old, f, w, b0);
+				const double t_new = bench (&draw_new, f, w, b1);
+				printf ("%4dp    %-10s %-14s %10.1f %10.1f %7.1fx\n",
+						movie_height, f->name, w->name, t_old, t_new, t_old / t_new);
+			}
+			free (ref);
+			free (b0);
+			free (b1);
+		}
+
+		for (j = 0; j < sizeof (work) / sizeof (work[0]); ++j) {
+			free (work[j].img);
+		}
+	}
+	return rv;
+}
@@ -0,0 +1,228 @@
+/* seekbench - compare xjadeo's pass 3 seek-table construction methods
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+
+/* Pass 3 of the indexer (src/xjadeo/xjadeo.c, idx3_finalize_chunk())
+ * assigns a seek keyframe to every frame: the last keyframe whose
+ * frame-PTS is at or before the frame's timestamp, looking ahead
+ * 2 + max-keyframe-interval frames for reordered (B-)frames.
+ *
+ * This builds synthetic keyframe tables for GOP sizes 1 .. 1000 and
+ * runs the previous method (binary search, then scan back, for every
+ * frame) and the current one (a single forward sweep per chunk),
+ * verifies that both assign the same keyframes, and prints timings.
+ * The data layout and the keyframe search mirror xjadeo.c.
+ */
+
+#define NOPTS (INT64_MIN)
+#define IDX2_CHUNK (64)
+
+struct KeyframeIndex {
+	int64_t frame; ///< frame number (decode order)
+	int64_t pkt_pts;
+	int64_t pkt_pos;
+	int64_t frame_pts;
+	int64_t frame_pos;
+};
+
+#define KF_BLOCK_BITS (10)
+#define KF_BLOCK (1 << KF_BLOCK_BITS)
+#define KF(k) (&kfidx[(k) >> KF_BLOCK_BITS][(k) & (KF_BLOCK - 1)])
+
+static struct KeyframeIndex **kfidx = NULL;
+static int64_t kfblocks = 0;
+static int64_t kfcnt = 0;
+static int64_t fcnt = 0;
+static int     max_kfi = 0;
+
+static int64_t frame_timestamp (const int64_t i) {
+	return i; // time-base: one frame
+}
+
+/* last keyframe at or before the given frame, -1 if none */
+static int64_t kf_find (const int64_t frame) {
+	int64_t lo = 0, hi = kfcnt - 1;
+	if (hi < 0 || KF(0)->frame > frame) return -1;
+	while (lo < hi) {
+		const int64_t mid = lo + (hi - lo + 1) / 2;
+		if (KF(mid)->frame <= frame) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+static int64_t keyframe_lookup_helper (const int64_t kl, const int64_t ts) {
+	int64_t k;
+	for (k = kl; k >= 0; --k) {
+		const struct KeyframeIndex *kf = KF(k);
+		if (kf->pkt_pts == NOPTS || kf->frame_pts == NOPTS) {
+			continue;
+		}
+		if (kf->frame_pts <= ts) {
+			return k;
+		}
+	}
+	return -1;
+}
+
+/* previous method: binary search of the look-ahead bound for every frame */
+static void pass3_search (int32_t *fidx) {
+	int64_t c, i;
+	for (c = 0; c * IDX2_CHUNK < fcnt; ++c) {
+		const int64_t end = c * IDX2_CHUNK + IDX2_CHUNK < fcnt ? c * IDX2_CHUNK + IDX2_CHUNK : fcnt;
+		for (i = c * IDX2_CHUNK; i < end; ++i) {
+			const int64_t la = i + 2 + max_kfi < fcnt - 1 ? i + 2 + max_kfi : fcnt - 1;
+			fidx[i] = keyframe_lookup_helper (kf_find (la), frame_timestamp (i));
+		}
+	}
+}
+
+/* current method: advance the bound while sweeping each chunk */
+static void pass3_sweep (int32_t *fidx) {
+	int64_t c, i;
+	for (c = 0; c * IDX2_CHUNK < fcnt; ++c) {
+		const int64_t first = c * IDX2_CHUNK;
+		const int64_t end = first + IDX2_CHUNK < fcnt ? first + IDX2_CHUNK : fcnt;
+		int64_t kl = kf_find (first + 2 + max_kfi < fcnt - 1 ? first + 2 + max_kfi : fcnt - 1);
+		for (i = first; i < end; ++i) {
+			const int64_t la = i + 2 + max_kfi < fcnt - 1 ? i + 2 + max_kfi : fcnt - 1;
+			while (kl + 1 < kfcnt && KF(kl + 1)->frame <= la) {
+				++kl;
+			}
+			fidx[i] = keyframe_lookup_helper (kl, frame_timestamp (i));
+		}
+	}
+}
+
+static void kf_free (void) {
+	int64_t b;
+	for (b = 0; b < kfblocks; ++b) {
+		free (kfidx[b]);
+	}
+	free (kfidx);
+	kfidx = NULL;
+	kfcnt = 0;
+}
+
+/* keyframes every `gop` frames (+-25% if `vary`), with B-frame
+ * reordering: a keyframe's PTS may be up to 2 frames later than its
+ * position in decode order. Some keyframes have no PTS.
+ */
+static void kf_generate (const int64_t frames, const int gop, const int vary) {
+	int64_t f = 0;
+	kfblocks = frames / KF_BLOCK + 1;
+	kfidx = calloc (kfblocks, sizeof (struct KeyframeIndex *));
+	fcnt = frames;
+	max_kfi = 0;
+	while (f < frames) {
+		int d = gop;
+		if (vary && gop > 3) {
+			d += (rand () % (gop / 2 + 1)) - gop / 4;
+		}
+		if (d < 1) d = 1;
+		const int64_t b = kfcnt >> KF_BLOCK_BITS;
+		if (!kfidx[b]) {
+			kfidx[b] = malloc (KF_BLOCK * sizeof (struct KeyframeIndex));
+		}
+		struct KeyframeIndex *kf = KF(kfcnt);
+		kf->frame = f;
+		kf->pkt_pts = kf->frame_pts = f + (gop > 2 ? rand () % 3 : 0);
+		kf->pkt_pos = kf->frame_pos = f * 1000;
+		if (gop > 1 && (rand () % 50) == 0) {
+			kf->frame_pts = NOPTS;
+		}
+		++kfcnt;
+		if (d > max_kfi) max_kfi = d;
+		f += d;
+	}
+}
+
+static double now (void) {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* average time per run in msec */
+static double bench (void (*pass3)(int32_t*), int32_t *fidx) {
+	int n = 0;
+	double t0 = now ();
+	double t1 = t0;
+	while (t1 - t0 < .25 || n < 3) {
+		pass3 (fidx);
+		++n;
+		t1 = now ();
+	}
+	return 1e3 * (t1 - t0) / n;
+}
+
+int main (int argc, char **argv) {
+	static const int gops[] = { 1, 2, 5, 12, 25, 50, 100, 250, 500, 1000 };
+	const int64_t frames = argc > 1 ? atoll (argv[1]) : 180000; // 2h at 25fps
+	unsigned int g;
+	int vary;
+	int rv = 0;
+
+	if (frames < 1) {
+		fprintf (stderr, "usage: %s [number of frames]\n", argv[0]);
+		return 1;
+	}
+
+	int32_t *f0 = malloc (frames * sizeof (int32_t));
+	int32_t *f1 = malloc (frames * sizeof (int32_t));
+
+	srand (1);
+	printf ("%"PRId64" frames\n", frames);
+	printf ("%6s %-6s %10s %8s %12s %12s %8s\n", "GOP", "", "keyframes", "max-kfi", "search [ms]", "sweep [ms]", "speedup");
+
+	for (g = 0; g < sizeof (gops) / sizeof (gops[0]); ++g) {
+		for (vary = 0; vary < 2; ++vary) {
+			int64_t i;
+			kf_generate (frames, gops[g], vary);
+
+			pass3_search (f0);
+			pass3_sweep (f1);
+			for (i = 0; i < frames; ++i) {
+				if (f0[i] != f1[i]) {
+					fprintf (stderr, "MISMATCH: GOP %d frame %"PRId64": %d vs %d\n", gops[g], i, f0[i], f1[i]);
+					rv = 1;
+					break;
+				}
+			}
+
+			const double t_search = bench (&pass3_search, f0);
+			const double t_sweep  = bench (&pass3_sweep, f1);
+			printf ("%6d %-6s %10"PRId64" %8d %12.2f %12.2f %7.1fx\n",
+					gops[g], vary ? "vary" : "fixed", kfcnt, max_kfi,
+					t_search, t_sweep, t_search / t_sweep);
+			kf_free ();
+		}
+	}
+
+	free (f0);
+	free (f1);
+	return rv;
+}
@@ -67,6 +67,11 @@ extern char  *midi_driver;
 extern int    use_jack;
 extern int    interaction_override;
 extern int    keyframe_interval_limit;
+extern int    frame_cache_mb;
+extern int    readahead_frames;
+extern int    decoder_threads;
+extern int    scale_threads;
+extern int    index_threads;
 
 #ifdef HAVE_LTC
 extern int  use_ltc;
@@ -85,6 +90,14 @@ extern int    osc_port;
 extern int    want_dropframes;
 extern int    want_autodrop;
 extern int    want_genpts;
+extern int    want_idxcache;
+extern int    want_idxinline;
+extern int    want_glyuv;
+extern int    want_glthread;
+extern int    want_prescale;
+extern int    want_syncsmooth;
+extern double syncsmooth_bw;
+extern int    want_jacksnapshot;
 extern int    want_ignstart;
 extern int    OSD_mode;
 extern char   OSD_text[128];
@@ -155,6 +168,13 @@ int parseoption (char *item, char *value) {
 			midi_driver = strdup(value);
 #endif
 		rv=1;
+	} else if (!strncasecmp(item,"JACKSNAPSHOT",12)) {
+		YES_OK(want_jacksnapshot)
+	} else if (!strncasecmp(item,"SYNCSMOOTHBW",12)) {
+		if (atof(value) > 0) syncsmooth_bw = atof(value);
+		rv=1;
+	} else if (!strncasecmp(item,"SYNCSMOOTH",10)) {
+		want_syncsmooth=atoi(value); rv=1;
 	} else if (!strncasecmp(item,"SYNCSOURCE",10)) {
 		use_jack=1;
 #ifdef HAVE_LTC
@@ -211,8 +231,24 @@ int parseoption (char *item, char *value) {
 		rv=1; // legacy -- ignore
 	} else if (!strncasecmp(item,"LETTERBOX",9)) {
 		YES_OK(want_letterbox)
+	} else if (!strncasecmp(item,"GLYUV",5)) {
+		YES_OK(want_glyuv)
+	} else if (!strncasecmp(item,"GLTHREAD",8)) {
+		YES_OK(want_glthread)
+	} else if (!strncasecmp(item,"PRESCALE",8)) {
+		YES_OK(want_prescale)
 	} else if (!strncasecmp(item,"LASH",4)) {
 		rv=1; // legacy -- ignore
+	} else if (!strncasecmp(item,"FRAMECACHE",10)) {
+		frame_cache_mb=atoi(value); rv=1;
+	} else if (!strncasecmp(item,"READAHEAD",9)) {
+		readahead_frames=atoi(value); rv=1;
+	} else if (!strncasecmp(item,"DECODERTHREADS",14)) {
+		decoder_threads=atoi(value); rv=1;
+	} else if (!strncasecmp(item,"INDEXTHREADS",12)) {
+		index_threads=atoi(value); rv=1;
+	} else if (!strncasecmp(item,"SCALETHREADS",12)) {
+		scale_threads=atoi(value); rv=1;
 	} else if (!strncasecmp(item,"FONTFILE",8)) {
 		strncpy(OSD_fontfile,value,1023);rv=1;
 		OSD_fontfile[1023]=0; // just to be sure.
@@ -246,6 +282,10 @@ int parseoption (char *item, char *value) {
 		YES_OK(start_fullscreen)
 	} else if (!strncasecmp(item,"GENPTS",6)) {
 		YES_OK(want_genpts)
+	} else if (!strncasecmp(item,"INDEXCACHE",10)) {
+		YES_OK(want_idxcache)
+	} else if (!strncasecmp(item,"INDEXINLINE",11)) {
+		YES_OK(want_idxinline)
 	} else if (!strncasecmp(item,"IGNORESTART",11)) {
 		YES_OK(want_ignstart)
 	} else if (!strncasecmp(item,"DROPFRAMES",10)) {
@@ -408,6 +448,9 @@ int saveconfig (const char *fn) {
 	fprintf(fp, "\n## Settings ##\n");
 	fprintf(fp, "MOVIEFILE=%s\n", current_file);
 	fprintf(fp, "LETTERBOX=%s\n", BOOL(want_letterbox));
+	fprintf(fp, "GLYUV=%s\n", BOOL(want_glyuv));
+	fprintf(fp, "GLTHREAD=%s\n", BOOL(want_glthread));
+	fprintf(fp, "PRESCALE=%s\n", BOOL(want_prescale));
 	fprintf(fp, "VIDEOMODE=%i\n", videomode); // XXX
 	fprintf(fp, "FPS=%f\n", delay<1?-1:1.0/delay);
 	fprintf(fp, "OSCPORT=%i\n", osc_port);
@@ -419,6 +462,11 @@ int saveconfig (const char *fn) {
 	fprintf(fp, "QUIET=%s\n", BOOL(want_quiet));
 	fprintf(fp, "IAOVERRIDE=%i\n", interaction_override);
 	fprintf(fp, "KEYFRAMELIMIT=%i\n", keyframe_interval_limit);
+	fprintf(fp, "FRAMECACHE=%i\n", frame_cache_mb);
+	fprintf(fp, "READAHEAD=%i\n", readahead_frames);
+	fprintf(fp, "DECODERTHREADS=%i\n", decoder_threads);
+	fprintf(fp, "INDEXTHREADS=%i\n", index_threads);
+	fprintf(fp, "SCALETHREADS=%i\n", scale_threads);
 
 	fprintf(fp, "\n## Sync settings ##\n");
 #ifdef HAVE_MIDI
@@ -441,9 +489,14 @@ int saveconfig (const char *fn) {
 #endif
 	if (jack_connected()) ss=1;
 	fprintf(fp, "SYNCSOURCE=%i\n", ss);
+	fprintf(fp, "SYNCSMOOTH=%i\n", want_syncsmooth);
+	fprintf(fp, "SYNCSMOOTHBW=%g\n", syncsmooth_bw);
+	fprintf(fp, "JACKSNAPSHOT=%s\n", BOOL(want_jacksnapshot));
 
 	fprintf(fp, "\n## Decoder settings ##\n");
 	fprintf(fp, "GENPTS=%s\n", BOOL(want_genpts));
+	fprintf(fp, "INDEXCACHE=%s\n", BOOL(want_idxcache));
+	fprintf(fp, "INDEXINLINE=%s\n", BOOL(want_idxinline));
 	fprintf(fp, "IGNORESTART=%s\n", BOOL(want_ignstart));
 	fprintf(fp, "DROPFRAMES=%s\n", BOOL(want_dropframes));
 	fprintf(fp, "AUTODF=%s\n", BOOL(want_autodrop));
@@ -21,6 +21,10 @@
 #include "xjadeo.h"
 #include "display.h"
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "gtime.h"
 
 #include <libavcodec/avcodec.h> // needed for PIX_FMT
 #include <libavformat/avformat.h>
@@ -41,6 +45,7 @@ extern double framerate;
 extern float index_progress;
 extern uint8_t splashed ;
 uint8_t osd_seeking = 0;
+int gl_yuv_unavailable = 0;
 
 /*******************************************************************************
  * NULL Video Output
@@ -81,78 +86,36 @@ void stride_memcpy(void * dst, const void * src, int width, int height, int dstS
  * overlay render directly on image on the given buffer
  */
 
-typedef struct {
-	size_t Uoff;
-	size_t Voff;
-	int bpp;
-} rendervars;
-
-static void _overlay_YUV422 (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = (2 * dx + movie_width * dy * 2);
-	mybuffer[yoff+1] = 0xff - ((mybuffer[yoff+1] >> 1) + (val >> 1));
-	mybuffer[yoff+3] = 0xff - ((mybuffer[yoff+3] >> 1) + (val >> 1));
-}
-
-static void _overlay_YUV (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = (dx + movie_width * dy);
-	mybuffer[yoff] = 0xff - ((mybuffer[yoff] >> 1)  + (val >> 1));
-}
-
-static void _overlay_RGB (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int pos = rv->bpp * (dx + movie_width * dy);
-	mybuffer[pos]  = 0xff - ((mybuffer[pos]   >> 1) + (val >> 1));
-	mybuffer[pos+1]= 0xff - ((mybuffer[pos+1] >> 1) + (val >> 1));
-	mybuffer[pos+2]= 0xff - ((mybuffer[pos+2] >> 1) + (val >> 1));
-}
-
-static void _render_YUV422 (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = 2 * dx + movie_width * dy * 2;
-	mybuffer[yoff+0] = 0x80;
-	mybuffer[yoff+1] = val;
-	mybuffer[yoff+2] = 0x80;
-	mybuffer[yoff+3] = val;
-}
-
-static void _render_YUV (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = (dx + movie_width * dy);
-	const int uvoff = (dx / 2) + movie_width / 2 * (dy / 2);
-	mybuffer[yoff] = val;
-	mybuffer[rv->Uoff+uvoff] = 0x80;
-	mybuffer[rv->Voff+uvoff] = 0x80;
-}
-
-static void _render_RGB (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int pos = rv->bpp * (dx + movie_width * dy);
-	mybuffer[pos] = val;
-	mybuffer[pos+1] = val;
-	mybuffer[pos+2] = val;
-}
-
-static void _red_render_YUV422 (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = 2 * (dx&~1) + movie_width * dy * 2;
-	if (val > 0x10) {
-		mybuffer[yoff+0] = 0x40;
-		mybuffer[yoff+2] = 0xb0;
+#include "display_osd.h"
+
+static const osd_kernels *osd_kernels_for (int rfmt) {
+	switch (rfmt) {
+		case AV_PIX_FMT_YUV420P:
+			return &osd_YUV;
+		case AV_PIX_FMT_UYVY422:
+			return &osd_YUV422;
+		case AV_PIX_FMT_RGB24:
+			return &osd_RGB3;
+		case AV_PIX_FMT_RGBA32:
+		case AV_PIX_FMT_BGRA32:
+			return &osd_RGB4;
+		default:
+			return NULL;
 	}
-	if (dx%2)
-		mybuffer[yoff+3] = val >> 1;
-	else
-		mybuffer[yoff+1] = val >> 1;
-}
-
-static void _red_render_YUV (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int yoff = (dx + movie_width * dy);
-	const int uvoff = (dx / 2) + movie_width / 2 * (dy / 2);
-	mybuffer[yoff] = val > 0x90 ? 0x90 : val;
-	mybuffer[rv->Uoff+uvoff] = val > 0x10 ? 0x50 : 0x80;
-	mybuffer[rv->Voff+uvoff] = val > 0x10 ? 0xc0 : 0x80;
 }
 
-static void _red_render_RGB (uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val) {
-	const int pos = rv->bpp * (dx + movie_width * dy);
-	mybuffer[pos] = val>>2;
-	mybuffer[pos+1] = val>>2;
-	mybuffer[pos+2] = val;
+/* draw a single pixel, or a horizontal line of constant value */
+static void osd_hline (osd_span fn, uint8_t *mybuffer, int x0, int x1, const int y, const uint8_t val) {
+	uint8_t v[64];
+	memset (v, val, sizeof (v));
+	x0 = MAX(0, x0);
+	x1 = MIN(movie_width, x1);
+	if (y < 0 || y >= movie_height) return;
+	while (x0 < x1) {
+		const int n = MIN(x1 - x0, (int)sizeof (v));
+		fn (mybuffer, x0, y, v, n, 0);
+		x0 += n;
+	}
 }
 
 
@@ -327,6 +290,10 @@ int vidoutmode(int user_req) {
 	if (user_req < i && user_req > 0)
 		if (VO[user_req].supported) VOutput = user_req;
 
+	if (VOutput == VO_GL && want_glyuv && !gl_yuv_unavailable) {
+		// upload the planes as-is, the GL VO converts them using a shader
+		return AV_PIX_FMT_YUV420P;
+	}
 	return VO[VOutput].render_fmt;
 }
 
@@ -334,52 +301,40 @@ int vidoutmode(int user_req) {
  * On Screen Display
  */
 
-extern unsigned char ST_image[][ST_WIDTH];
+extern unsigned char (*ST_image)[ST_WIDTH];
 extern int ST_rightend;
 extern int ST_height;
 extern int ST_top;
 
 #define PB_W (movie_width - 2 * PB_X)
 
-#define SET_RFMT(FORMAT, POINTER, VARS, FUNC) \
-	if ((FORMAT) == AV_PIX_FMT_YUV420P) \
-		(POINTER) = &_##FUNC##_YUV; \
-	else if ((FORMAT) == AV_PIX_FMT_UYVY422) \
-		(POINTER) = &_##FUNC##_YUV422; \
-	else if ((FORMAT) == AV_PIX_FMT_RGB24) { \
-		 (POINTER) = &_##FUNC##_RGB; \
-		VARS.bpp = 3; \
-	} else if ((FORMAT) == AV_PIX_FMT_RGBA32) { \
-		(POINTER) = &_##FUNC##_RGB; \
-		VARS.bpp = 4; \
-	} else if ((FORMAT) == AV_PIX_FMT_BGRA32) { \
-		(POINTER) = &_##FUNC##_RGB; \
-		VARS.bpp = 4; \
-	} else return ;
-
 #if (HAVE_LIBXV || HAVE_IMLIB2)
 static void OSD_bitmap(int rfmt, uint8_t *mybuffer, int yperc, int xoff, int w, int h, uint8_t *src, uint8_t *mask) {
-	int x, y, xalign, yalign;
-	rendervars rv;
-	void (*_render)(uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val);
-
-	rv.Uoff  = movie_width * movie_height;
-	rv.Voff = rv.Uoff + movie_width * movie_height/4;
-	rv.bpp = 0;
+	int x, y, xalign, yalign, n;
+	uint8_t val[256];
+	const osd_kernels *k = osd_kernels_for (rfmt);
+	if (!k) return;
 
 	xalign = (movie_width - w) / 2;
 	yalign = (movie_height - h) * yperc / 100.0;
 	if (xalign < 0) xalign = 0;
 	if (yalign < 0) yalign = 0;
 
-	SET_RFMT(rfmt, _render, rv, render); // TODO once per window, and rather make _render fn's inline, include LOOP in fn pointer.
+	n = MIN(w, movie_width - xalign);
 
-	for (x = 0; x < w && (x + xalign) < movie_width; ++x) {
-		for (y = 0; y < h && (y + yalign) < movie_height; ++y) {
-			int byte = ((y * w + x) >> 3); // PIXMAP width must be mult. of 8 !
-			int val = src[byte] & (1 << (x % 8));
-			if (!mask || mask[byte] & (1 << (x % 8)))
-				_render (mybuffer, &rv, (x + xalign), (y + yalign), val ? 0xee : 0x11);
+	for (y = 0; y < h && (y + yalign) < movie_height; ++y) {
+		int c;
+		for (c = 0; c < n; c += sizeof (val)) {
+			const int m = MIN(n - c, (int)sizeof (val));
+			for (x = 0; x < m; ++x) {
+				const int byte = ((y * w + x + c) >> 3); // PIXMAP width must be mult. of 8 !
+				const int bit = 1 << ((x + c) % 8);
+				if (!mask || mask[byte] & bit)
+					val[x] = (src[byte] & bit) ? 0xee : 0x11;
+				else
+					val[x] = 0;
+			}
+			k->render (mybuffer, xalign + c, y + yalign, val, m, 1);
 		}
 	}
 }
@@ -387,27 +342,27 @@ static void OSD_bitmap(int rfmt, uint8_t *mybuffer, int yperc, int xoff, int w,
 
 static void OSD_cmap(int rfmt, uint8_t *mybuffer, int yperc, int xoff, const int w, const int h,
 		uint8_t const * const img, uint8_t const * const map) {
-	int x, y, xalign, yalign;
-	rendervars rv;
-	void (*_render)(uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val);
-
-	rv.Uoff = movie_width * movie_height;
-	rv.Voff = rv.Uoff + movie_width * movie_height / 4;
-	rv.bpp  = 0;
+	int x, y, xalign, yalign, n;
+	uint8_t val[256];
+	const osd_kernels *k = osd_kernels_for (rfmt);
+	if (!k) return;
 
 	xalign = (movie_width - w) / 2;
 	yalign = (movie_height - h) * yperc / 100.0;
 	if (xalign < 0) xalign = 0;
 	if (yalign < 0) yalign = 0;
 
-	SET_RFMT(rfmt, _render, rv, render); // TODO once per window, and rather make _render fn's inline, include LOOP in fn pointer.
+	n = MIN(w, movie_width - xalign);
 
 	for (y = 0; y < h && (y + yalign) < movie_height; ++y) {
-		const int y0 = w * y;
-		for (x = 0; x < w && (x + xalign) < movie_width; ++x) {
-			const int pos = y0 + x;
-			uint8_t val = map[(uint8_t)img[pos]];
-			_render (mybuffer, &rv, (x+xalign), (y+yalign), val);
+		const uint8_t *row = &img[w * y];
+		int c;
+		for (c = 0; c < n; c += sizeof (val)) {
+			const int m = MIN(n - c, (int)sizeof (val));
+			for (x = 0; x < m; ++x) {
+				val[x] = map[row[x + c]];
+			}
+			k->render (mybuffer, xalign + c, y + yalign, val, m, 0);
 		}
 	}
 }
@@ -418,49 +373,48 @@ static void OSD_cmap(int rfmt, uint8_t *mybuffer, int yperc, int xoff, const int
 
 static void OSD_bar (int rfmt, uint8_t *mybuffer, int yperc, double min, double max, double val, double tara)
 {
-	int x, y, xalign, yalign;
-	rendervars rv;
-	void (*_render)(uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val);
+	int x, y, xalign, yalign, n;
+	uint8_t stripe[2][9];
+	const osd_kernels *k = osd_kernels_for (rfmt);
+	if (!k) return;
 	if (movie_width < 4 * PB_X || movie_height < 6 * PB_H) return;
 
-	rv.Uoff  = movie_width * movie_height;
-	rv.Voff = rv.Uoff + movie_width * movie_height/4;
-	rv.bpp = 0;
-
 	xalign = PB_X;
 	yalign = (movie_height - PB_H) * yperc / 100.0;
 	int pb_val = (int) (PB_W * (val-min) / (max - min));
 	int pb_not = (int) (PB_W * (tara-min) / (max - min));
 
-	SET_RFMT(rfmt, _render, rv, overlay); // TODO once per window instance, inline _render.
+	/* bars'n'stripes: 6 pixels on, 3 off; the first row and column
+	 * of each stripe are dark */
+	for (x = 0; x < 9; ++x) {
+		stripe[0][x] = x > 5 ? 0 : 0x20;
+		stripe[1][x] = x > 5 ? 0 : (x ? 0xf0 : 0x20);
+	}
 
-	for (x = 0; x < pb_val && (x + xalign) < movie_width; ++x) {
-		for (y = 3; y < PB_H && (y + yalign) < movie_height; ++y) {
-			_render (mybuffer, &rv, x + xalign, y + yalign,
-					(x % 9 && y != 3) ? 0xf0 : 0x20);
+	n = MIN(pb_val, movie_width - xalign);
+	for (y = 3; y < PB_H && (y + yalign) < movie_height; ++y) {
+		const uint8_t *s = stripe[y != 3 ? 1 : 0];
+		if (y + yalign < 0) continue;
+		for (x = 0; x < n; x += 9) {
+			k->overlay (mybuffer, x + xalign, y + yalign, s, MIN(6, n - x), 1);
 		}
-		if ((x % 9) == 5) x += 3; // bars'n'stripes
 	}
 	if (tara >= min) {
 		/* zero notch */
-		for (x = pb_not - 1; x < pb_not + 2 && (x + xalign) < movie_width; ++x) {
-			for (y = 0; x >= 0 && y < 3 && (y + yalign) < movie_height; ++y)
-				_render (mybuffer, &rv, x + xalign, y + yalign, 0);
-			for (y = PB_H; x >= 0 && y < PB_H + 3 && (y + yalign) < movie_height; ++y)
-				_render (mybuffer, &rv, x + xalign, y + yalign, 0);
-		}
+		const int x0 = MAX(0, pb_not - 1) + xalign;
+		const int x1 = pb_not + 2 + xalign;
+		for (y = 0; y < 3 && (y + yalign) < movie_height; ++y)
+			osd_hline (k->overlay, mybuffer, x0, x1, y + yalign, 0);
+		for (y = PB_H; y < PB_H + 3 && (y + yalign) < movie_height; ++y)
+			osd_hline (k->overlay, mybuffer, x0, x1, y + yalign, 0);
 	} else if (tara < min - 1) {
 		/* border */
 		const uint8_t bcol = tara < min - 2 ? 0x10 : 0xf0;
-		for (x = -2; x < PB_W + 1 && (x + xalign) < movie_width; ++x) {
-			if (yalign >= 0 && yalign < movie_height)
-				_render (mybuffer, &rv, x + xalign, yalign, bcol);
-			if (yalign + PB_H + 3 >= 0 && yalign + PB_H + 3 < movie_height)
-				_render (mybuffer, &rv, x + xalign, yalign + PB_H + 3, bcol);
-		}
+		osd_hline (k->overlay, mybuffer, xalign - 2, xalign + PB_W + 1, yalign, bcol);
+		osd_hline (k->overlay, mybuffer, xalign - 2, xalign + PB_W + 1, yalign + PB_H + 3, bcol);
 		for (y = 1; y < PB_H + 3 && (y + yalign) < movie_height; ++y) {
-			_render (mybuffer, &rv, PB_X - 3 , y + yalign, bcol);
-			_render (mybuffer, &rv, PB_X + PB_W + 1, y + yalign, bcol);
+			osd_hline (k->overlay, mybuffer, PB_X - 3, PB_X - 2, y + yalign, bcol);
+			osd_hline (k->overlay, mybuffer, PB_X + PB_W + 1, PB_X + PB_W + 2, y + yalign, bcol);
 		}
 	}
 }
@@ -481,20 +435,16 @@ static void OSD_render (int rfmt, uint8_t *mybuffer, char *text, int xpos, int y
 	static int minw_frame = 0;
 	static int minw_smpte = 0;
 
-	int x, y, xalign, yalign;
-	rendervars rv;
-	void (*_render)(uint8_t *mybuffer, rendervars *rv, const int dx, const int dy, const uint8_t val);
+	int x0, x1, y, xalign, yalign;
+	osd_span _render;
+	const osd_kernels *k = osd_kernels_for (rfmt);
 
-	if (strlen(text) == 0) return;
-
-	rv.Uoff = movie_width * movie_height;
-	rv.Voff = rv.Uoff + movie_width * movie_height/4;
-	rv.bpp = 0;
+	if (strlen(text) == 0 || !k) return;
 
 	if ((!strncmp(text, "++ ", 3) || !strncmp(text, "-- ", 3)) && strstr(text, " EOF")) {
-		SET_RFMT(rfmt, _render, rv, red_render);
+		_render = k->red_render;
 	} else {
-		SET_RFMT(rfmt, _render, rv, render);
+		_render = k->render;
 	}
 
 	if (OSD_movieheight != movie_height) {
@@ -544,30 +494,21 @@ static void OSD_render (int rfmt, uint8_t *mybuffer, char *text, int xpos, int y
 
 	if (!ST_BG) {
 		for (y = 0; y < fh && (y + yalign) < movie_height; ++y) {
-			for (x = -4; x < 0; ++x) {
-				if (x + xalign >= 0)
-					_render (mybuffer, &rv, x + xalign, y +yalign, 0);
-				if (ST_rightend + xalign - x - 1 < movie_width)
-					_render (mybuffer, &rv, ST_rightend + xalign - x - 1, y + yalign, 0);
-			}
+			osd_hline (_render, mybuffer, xalign - 4, xalign, y + yalign, 0);
+			osd_hline (_render, mybuffer, xalign + ST_rightend, xalign + ST_rightend + 4, y + yalign, 0);
 		}
-		for (x = xalign - 4; x < xalign + ST_rightend + 4; ++x) {
-			if (x < 0 || x >= movie_width)
-				continue;
-			for (y = 0; y < 4; ++y) {
-				if (yalign - 1 - y >= 0 && yalign - y < movie_height)
-					_render (mybuffer, &rv, x, yalign - y, 0);
-				if (yalign + fh + y >= 0 && yalign + fh + y < movie_height)
-					_render (mybuffer, &rv, x, y + fh + yalign, 0);
-			}
+		for (y = 0; y < 4; ++y) {
+			if (yalign - 1 - y >= 0)
+				osd_hline (_render, mybuffer, xalign - 4, xalign + ST_rightend + 4, yalign - y, 0);
+			osd_hline (_render, mybuffer, xalign - 4, xalign + ST_rightend + 4, yalign + fh + y, 0);
 		}
 	}
+
+	x0 = MAX(0, -xalign);
+	x1 = MIN(ST_rightend, movie_width - xalign);
 	for (y = 0; y < fh && (y + yalign) < movie_height; ++y) {
-		for (x = 0; x < ST_rightend && (x + xalign) < movie_width; ++x) {
-			if (ST_image[y + fo][x] >= ST_BG) {
-				if (x + xalign >= 0)
-					_render (mybuffer, &rv, x + xalign, y + yalign, ST_image[y + fo][x]);
-			}
+		if (x1 > x0 && y + yalign >= 0) {
+			_render (mybuffer, x0 + xalign, y + yalign, &ST_image[y + fo][x0], x1 - x0, ST_BG);
 		}
 	}
 }
@@ -577,7 +518,7 @@ static void OSD_render (int rfmt, uint8_t *mybuffer, char *text, int xpos, int y
 void splash (uint8_t *mybuffer) {
 	if (want_nosplash) return;
 	if (movie_width >= xjadeo_splash_height && movie_height >= xjadeo_splash_width)
-		OSD_cmap (VO[VOutput].render_fmt, mybuffer, 50, 0,
+		OSD_cmap (render_fmt, mybuffer, 50, 0,
 				xjadeo_splash_width, xjadeo_splash_height, xjadeo_splash, xjadeo_splash_cmap);
 }
 
@@ -597,16 +538,100 @@ static void update_smptestring () {
 #endif
 
 #define OBM(NAME, YPOS) \
-	OSD_bitmap(VO[VOutput].render_fmt, mybuffer, YPOS, 0, osd_##NAME##_width, osd_##NAME##_height, osd_##NAME##_bits, osd_##NAME##_mask_bits);
+	OSD_bitmap(render_fmt, mybuffer, YPOS, 0, osd_##NAME##_width, osd_##NAME##_height, osd_##NAME##_bits, osd_##NAME##_mask_bits);
+
+/* Signature (FNV-1a) of the video-output state and of everything
+ * render_buffer() draws on top of the video frame. It is only
+ * computed for forced redraws of the same frame: render_is_current()
+ * compares it to the one of the last such redraw, any other
+ * render_buffer() call invalidates it.
+ */
+static uint64_t render_sig = 0;
+static uint64_t render_sig_next = 0;
+
+#define SIG_VAL(V) sig = render_sig_add (sig, &(V), sizeof (V))
+#define SIG_STR(S) sig = render_sig_add (sig, (S), strlen (S) + 1)
+
+static uint64_t render_sig_add (uint64_t sig, const void *data, size_t len) {
+	const uint8_t *p = (const uint8_t *)data;
+	size_t i;
+	for (i = 0; i < len; ++i) {
+		sig ^= p[i];
+		sig *= 0x100000001b3ULL;
+	}
+	return sig;
+}
+
+static uint64_t render_signature (void) {
+	uint64_t sig = 0xcbf29ce484222325ULL;
+	unsigned int w = 0, h = 0;
+	int i, fs, sync;
+
+	Xgetsize (&w, &h);
+	fs = Xgetfullscreen ();
+	sync = ui_syncsource ();
+
+	SIG_VAL(VOutput);
+	SIG_VAL(render_fmt);
+	SIG_VAL(movie_width);
+	SIG_VAL(movie_height);
+	SIG_VAL(w);
+	SIG_VAL(h);
+	SIG_VAL(fs);
+	SIG_VAL(want_letterbox);
+
+	SIG_VAL(OSD_mode);
+	SIG_VAL(OSD_fx); SIG_VAL(OSD_fy);
+	SIG_VAL(OSD_sx); SIG_VAL(OSD_sy);
+	SIG_VAL(OSD_tx); SIG_VAL(OSD_ty);
+	SIG_STR(OSD_fontfile);
+	SIG_STR(OSD_frame);
+	SIG_STR(OSD_smpte);
+	SIG_STR(OSD_text);
+	SIG_STR(OSD_msg);
+	for (i = 0; i < 5; ++i) {
+		SIG_STR(OSD_nfo_tme[i]);
+		SIG_STR(OSD_nfo_geo[i]);
+	}
+	SIG_VAL(index_progress);
+	SIG_VAL(ts_offset);
+	SIG_VAL(dispFrame);
+	SIG_VAL(frames);
+	SIG_VAL(osd_seeking);
+	SIG_VAL(splashed);
+	SIG_VAL(sync);
+	SIG_VAL(interaction_override);
+
+#if (HAVE_LIBXV || HAVE_IMLIB2)
+	if ((OSD_mode & OSD_EQ) || VOutput == VO_XV || VOutput == VO_X11) {
+		static char * const eq[5] = { "brightness", "contrast", "gamma", "saturation", "hue" };
+		for (i = 0; i < 5; ++i) {
+			int v;
+			if (xj_get_eq (eq[i], &v)) v = 0;
+			SIG_VAL(v);
+		}
+	}
+#endif
+	return sig ? sig : 1;
+}
+
+/* returns 1 if a render_buffer() of the same video frame would
+ * not change the displayed image */
+int render_is_current (void) {
+	render_sig_next = render_signature ();
+	return render_sig == render_sig_next;
+}
 
 void render_buffer (uint8_t *mybuffer) {
 	if (!mybuffer) return;
+	render_sig = render_sig_next;
+	render_sig_next = 0;
 
 	// render OSD on buffer
 	if (OSD_mode & (OSD_FRAME | OSD_VTC))
-		OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_frame, OSD_fx, OSD_fy, MINWH_FRAMEN);
+		OSD_render (render_fmt, mybuffer, OSD_frame, OSD_fx, OSD_fy, MINWH_FRAMEN);
 	if (OSD_mode & OSD_SMPTE)
-		OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_smpte, OSD_sx, OSD_sy, MINWH_SYNCTC);
+		OSD_render (render_fmt, mybuffer, OSD_smpte, OSD_sx, OSD_sy, MINWH_SYNCTC);
 
 	if (!splashed) {
 		; // keep center free
@@ -623,46 +648,46 @@ void render_buffer (uint8_t *mybuffer) {
 		OBM(contrast, 23);
 		OBM(gamma, 43);
 		OBM(saturation, 63);
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 10, -1000.0, 1000.0, v0, 0.0);
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 30, -1000.0, 1000.0, v1, (VOutput == VO_XV) ? -500.0 : 0.0);
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 50, -1000.0, 1000.0, v2, 0.0);
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 70, -1000.0, 1000.0, v3, 0.0);
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 90, -1000.0, 1000.0, v4, 0.0);
+		OSD_bar (render_fmt, mybuffer, 10, -1000.0, 1000.0, v0, 0.0);
+		OSD_bar (render_fmt, mybuffer, 30, -1000.0, 1000.0, v1, (VOutput == VO_XV) ? -500.0 : 0.0);
+		OSD_bar (render_fmt, mybuffer, 50, -1000.0, 1000.0, v2, 0.0);
+		OSD_bar (render_fmt, mybuffer, 70, -1000.0, 1000.0, v3, 0.0);
+		OSD_bar (render_fmt, mybuffer, 90, -1000.0, 1000.0, v4, 0.0);
 	} else
 #endif
 	{
 		if (OSD_mode & OSD_TEXT)
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_text, OSD_tx, OSD_ty, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_text, OSD_tx, OSD_ty, MINWH_NONE);
 		if (OSD_mode & OSD_MSG)
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_msg, 50, 85, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_msg, 50, 85, MINWH_NONE);
 
 		if (index_progress >= 0 && index_progress <= 100 && movie_height >= OSD_MIN_NFO_HEIGHT) {
-			OSD_bar (VO[VOutput].render_fmt, mybuffer, 91, 0, 100.0, index_progress, -1);
+			OSD_bar (render_fmt, mybuffer, 91, 0, 100.0, index_progress, -1);
 		}
 
 		if (OSD_mode & OSD_OFFF) {
 			char tempoff[30];
 			snprintf(tempoff, 30, "O:  %"PRId64, ts_offset);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, tempoff, OSD_CENTER, 50, MINW__TC);
+			OSD_render (render_fmt, mybuffer, tempoff, OSD_CENTER, 50, MINW__TC);
 		} else if (OSD_mode&OSD_OFFS) {
 			char tempsmpte[30];
 			strcpy(tempsmpte, "O: ");
 			if (frame_to_smptestring(tempsmpte+3, ts_offset, 1)) {
 				strcat(tempsmpte, " +d");
 			}
-			OSD_render (VO[VOutput].render_fmt, mybuffer, tempsmpte, OSD_CENTER, 50, MINWH_SYNCTC);
+			OSD_render (render_fmt, mybuffer, tempsmpte, OSD_CENTER, 50, MINWH_SYNCTC);
 		} else if (OSD_mode & (OSD_NFO | OSD_IDXNFO) && movie_height >= OSD_MIN_NFO_HEIGHT) {
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_tme[0], OSD_CENTER, 31, MINWH_NONE);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_tme[1], OSD_CENTER, 41, MINW__TC);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_tme[2], OSD_CENTER, 50, MINWH_SYNCTC);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_tme[3], OSD_CENTER, 59, MINWH_SYNCTC);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_tme[4], OSD_CENTER, 68, MINWH_SYNCTC);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_tme[0], OSD_CENTER, 31, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_tme[1], OSD_CENTER, 41, MINW__TC);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_tme[2], OSD_CENTER, 50, MINWH_SYNCTC);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_tme[3], OSD_CENTER, 59, MINWH_SYNCTC);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_tme[4], OSD_CENTER, 68, MINWH_SYNCTC);
 		} else if (OSD_mode & (OSD_GEO) && movie_height >= OSD_MIN_NFO_HEIGHT) {
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_geo[0], OSD_CENTER, 31, MINWH_NONE);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_geo[1], OSD_CENTER, 41, MINWH_NONE);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_geo[2], OSD_CENTER, 50, MINWH_NONE);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_geo[3], OSD_CENTER, 59, MINWH_NONE);
-			OSD_render (VO[VOutput].render_fmt, mybuffer, OSD_nfo_geo[4], OSD_CENTER, 68, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_geo[0], OSD_CENTER, 31, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_geo[1], OSD_CENTER, 41, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_geo[2], OSD_CENTER, 50, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_geo[3], OSD_CENTER, 59, MINWH_NONE);
+			OSD_render (render_fmt, mybuffer, OSD_nfo_geo[4], OSD_CENTER, 68, MINWH_NONE);
 		}
 	}
 	if (OSD_mode & OSD_POS && index_progress < 0 && frames > 1 && movie_height >= OSD_MIN_NFO_HEIGHT) {
@@ -670,21 +695,92 @@ void render_buffer (uint8_t *mybuffer) {
 		if (ui_syncsource() != SYNC_NONE || (interaction_override&OVR_MENUSYNC)) {
 			sbox = -1;
 		}
-		OSD_bar (VO[VOutput].render_fmt, mybuffer, 100. * BAR_Y, 0, frames - 1, dispFrame, sbox);
+		OSD_bar (render_fmt, mybuffer, 100. * BAR_Y, 0, frames - 1, dispFrame, sbox);
 	}
 
 	VO[VOutput].render(buffer); // buffer = mybuffer (so far no share mem or sth)
 }
 
+/*******************************************************************************
+ * frame pacing statistics
+ *
+ * Outputs report each new frame they put on screen, and each frame that
+ * was replaced by a newer one before it could be shown. Intervals of
+ * 250ms or more (transport stopped, no new frames) are not counted.
+ */
+
+static pthread_mutex_t pacing_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t pacing_presented = 0;
+static uint64_t pacing_skipped = 0;
+static uint64_t pacing_n = 0;
+static int64_t  pacing_prev = 0;
+static double   pacing_sum = 0;
+static double   pacing_sum2 = 0;
+
+void pacing_frame_presented (void) {
+	const int64_t now = xj_get_monotonic_time ();
+	pthread_mutex_lock (&pacing_lock);
+	const double dt = (now - pacing_prev) / 1000.0;
+	if (pacing_prev > 0 && dt < 250) {
+		pacing_sum  += dt;
+		pacing_sum2 += dt * dt;
+		++pacing_n;
+	}
+	pacing_prev = now;
+	++pacing_presented;
+	pthread_mutex_unlock (&pacing_lock);
+}
+
+void pacing_frame_skipped (void) {
+	pthread_mutex_lock (&pacing_lock);
+	++pacing_skipped;
+	pthread_mutex_unlock (&pacing_lock);
+}
+
+void pacing_reset (void) {
+	pthread_mutex_lock (&pacing_lock);
+	pacing_presented = pacing_skipped = pacing_n = 0;
+	pacing_prev = 0;
+	pacing_sum = pacing_sum2 = 0;
+	pthread_mutex_unlock (&pacing_lock);
+}
+
+/* interval and jitter: mean and standard deviation of the time
+ * between presented frames [ms] */
+void pacing_stats (uint64_t *presented, uint64_t *skipped, double *interval, double *jitter) {
+	double avg = 0, var = 0;
+	pthread_mutex_lock (&pacing_lock);
+	if (pacing_n > 0) {
+		avg = pacing_sum / pacing_n;
+		var = pacing_sum2 / pacing_n - avg * avg;
+	}
+	if (presented) *presented = pacing_presented;
+	if (skipped)   *skipped   = pacing_skipped;
+	pthread_mutex_unlock (&pacing_lock);
+	if (interval) *interval = avg;
+	if (jitter)   *jitter   = var > 0 ? sqrt (var) : 0;
+}
+
 void open_window(void) {
 	if (want_verbose)
 		printf("Video output: %s\n", VO[VOutput].name);
+	render_sig = 0;
+	pacing_reset ();
 	if (VO[VOutput].open() ) {
 		if (!want_quiet)
 			fprintf(stderr, "Could not open video output.\n");
 		VOutput = 0;
 		loop_run = 0;
-	} else loop_run = 1;
+		return;
+	}
+	loop_run = 1;
+
+	if (VOutput == VO_GL && gl_yuv_unavailable && render_fmt == AV_PIX_FMT_YUV420P) {
+		// the GL output cannot convert YUV, let the decoder output BGRA
+		render_fmt = vidoutmode (VOutput);
+		init_moviebuffer ();
+		newsourcebuffer ();
+	}
 }
 
 void close_window(void) {
@@ -692,6 +788,14 @@ void close_window(void) {
 	VOutput = 0;
 	loop_run = 0;
 	VO[vmode].close();
+
+	uint64_t presented, skipped;
+	double interval, jitter;
+	pacing_stats (&presented, &skipped, &interval, &jitter);
+	if (want_verbose && presented > 0) {
+		printf("%s: presented %"PRIu64" frames, %"PRIu64" skipped. Frame interval: %.2f ms, jitter %.2f ms\n",
+				VO[vmode].name, presented, skipped, interval, jitter);
+	}
 }
 
 void handle_X_events (void) {
@@ -699,6 +803,7 @@ void handle_X_events (void) {
 }
 
 void newsourcebuffer (void) {
+	render_sig = 0;
 	VO[VOutput].newsrc();
 }
 
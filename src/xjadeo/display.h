@@ -7,6 +7,7 @@ extern int ffctv_width, ffctv_height;
 extern float movie_aspect;
 extern int loop_flag, loop_run;
 extern uint8_t *buffer;
+extern int render_fmt;
 
 extern int want_quiet;
 extern int want_debug;
@@ -14,6 +15,8 @@ extern int want_verbose;
 extern int start_ontop;
 extern int start_fullscreen;
 extern int want_letterbox;
+extern int want_glyuv;
+extern int gl_yuv_unavailable;
 extern int hide_mouse;
 extern int remote_en;
 extern int force_redraw;
@@ -39,6 +39,30 @@
 #ifndef GL_TEXTURE_RECTANGLE_ARB
 #define GL_TEXTURE_RECTANGLE_ARB 0x84F5
 #endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS 0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS 0x8B82
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef APIENTRY
+#define APIENTRY
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -53,6 +77,66 @@ static int          _gl_reexpose = 0;
 static unsigned int _gl_texture_id = 0;
 static int          _gl_vblank_sync = 0;
 
+/* render_fmt == AV_PIX_FMT_YUV420P: the planes are uploaded as-is
+ * and converted to RGB by a fragment shader. If the shader is not
+ * available, gl_yuv_unavailable is set and open_window() switches
+ * the decoder to BGRA output.
+ */
+static int          _gl_yuv = 0;
+static unsigned int _gl_yuv_tex[3] = {0, 0, 0};
+static GLuint       _gl_yuv_prog = 0;
+
+/* texture uploads are streamed through a ring of pixel buffer
+ * objects, glTexSubImage2D() then returns without waiting for
+ * the driver to copy the frame.
+ */
+#define GL_PBO_COUNT 3
+static int          _gl_pbo_ok = 0;
+static int          _gl_pbo_idx = 0;
+static size_t       _gl_pbo_size = 0;
+static GLuint       _gl_pbo[GL_PBO_COUNT] = {0, 0, 0};
+static int          _gl_tex_width = 0;
+static int          _gl_tex_height = 0;
+
+/* GL 2.0 entry points, resolved at runtime */
+static struct {
+	void   (APIENTRY *ActiveTexture) (GLenum);
+	GLuint (APIENTRY *CreateShader) (GLenum);
+	void   (APIENTRY *ShaderSource) (GLuint, GLsizei, const char **, const GLint *);
+	void   (APIENTRY *CompileShader) (GLuint);
+	void   (APIENTRY *GetShaderiv) (GLuint, GLenum, GLint *);
+	void   (APIENTRY *DeleteShader) (GLuint);
+	GLuint (APIENTRY *CreateProgram) (void);
+	void   (APIENTRY *AttachShader) (GLuint, GLuint);
+	void   (APIENTRY *LinkProgram) (GLuint);
+	void   (APIENTRY *GetProgramiv) (GLuint, GLenum, GLint *);
+	void   (APIENTRY *DeleteProgram) (GLuint);
+	void   (APIENTRY *UseProgram) (GLuint);
+	GLint  (APIENTRY *GetUniformLocation) (GLuint, const char *);
+	void   (APIENTRY *Uniform1i) (GLint, GLint);
+
+	void   (APIENTRY *GenBuffers) (GLsizei, GLuint *);
+	void   (APIENTRY *DeleteBuffers) (GLsizei, const GLuint *);
+	void   (APIENTRY *BindBuffer) (GLenum, GLuint);
+	void   (APIENTRY *BufferData) (GLenum, ptrdiff_t, const void *, GLenum);
+	void * (APIENTRY *MapBuffer) (GLenum, GLenum);
+	GLboolean (APIENTRY *UnmapBuffer) (GLenum);
+} _gl_fn;
+
+/* ITU-R BT.601, limited range -- same as libswscale's default */
+static const char *_gl_yuv_shader =
+	"#extension GL_ARB_texture_rectangle : enable\n"
+	"uniform sampler2DRect tex_y;\n"
+	"uniform sampler2DRect tex_u;\n"
+	"uniform sampler2DRect tex_v;\n"
+	"void main (void) {\n"
+	"  vec2 p = gl_TexCoord[0].st;\n"
+	"  float y = 1.1644 * (texture2DRect (tex_y, p).r - 0.0625);\n"
+	"  float u = texture2DRect (tex_u, p * 0.5).r - 0.5;\n"
+	"  float v = texture2DRect (tex_v, p * 0.5).r - 0.5;\n"
+	"  gl_FragColor = vec4 (y + 1.5960 * v, y - 0.3918 * u - 0.8130 * v, y + 2.0172 * u, 1.0);\n"
+	"}\n";
+
 ///////////////////////////////////////////////////////////////////////////////
 static void gl_make_current();
 static void gl_clear_current();
@@ -61,6 +145,8 @@ static void gl_swap_buffers();
 static void gl_sync_lock();
 static void gl_sync_unlock();
 
+static void *gl_get_proc_address(const char *proc);
+
 static void gl_reshape(int width, int height) {
 	gl_make_current();
 
@@ -80,6 +166,29 @@ static void gl_reshape(int width, int height) {
 	gl_clear_current();
 }
 
+static size_t gl_frame_size(int width, int height) {
+	if (render_fmt == AV_PIX_FMT_YUV420P && _gl_yuv) {
+		return (size_t) width * height * 3 / 2;
+	}
+	return (size_t) width * height * 4;
+}
+
+static void gl_reallocate_pbo(int width, int height) {
+	int i;
+	if (!_gl_pbo_ok) {
+		return;
+	}
+	_gl_pbo_size = gl_frame_size (width, height);
+	if (!_gl_pbo[0]) {
+		_gl_fn.GenBuffers (GL_PBO_COUNT, _gl_pbo);
+	}
+	for (i = 0; i < GL_PBO_COUNT; ++i) {
+		_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, _gl_pbo[i]);
+		_gl_fn.BufferData (GL_PIXEL_UNPACK_BUFFER, _gl_pbo_size, NULL, GL_STREAM_DRAW);
+	}
+	_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 static int gl_reallocate_texture(int width, int height) {
 	glDeleteTextures (1, &_gl_texture_id);
 	glViewport (0, 0, _gl_width, _gl_height);
@@ -89,14 +198,36 @@ static int gl_reallocate_texture(int width, int height) {
 
 	glClear (GL_COLOR_BUFFER_BIT);
 
+	gl_reallocate_pbo (width, height);
+	_gl_tex_width  = width;
+	_gl_tex_height = height;
+
+	if (_gl_yuv) {
+		int i;
+		glDeleteTextures (3, _gl_yuv_tex);
+		glGenTextures (3, _gl_yuv_tex);
+		for (i = 0; i < 3; ++i) {
+			// YUV420P: width and height are even, see open_movie()
+			glBindTexture (GL_TEXTURE_RECTANGLE_ARB, _gl_yuv_tex[i]);
+			glTexImage2D (GL_TEXTURE_RECTANGLE_ARB, 0, GL_LUMINANCE8,
+					i ? width / 2 : width, i ? height / 2 : height, 0,
+					GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+			glTexParameteri(GL_TEXTURE_RECTANGLE_ARB, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_RECTANGLE_ARB, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+#ifndef PLATFORM_WINDOWS
+			glTexParameteri(GL_TEXTURE_RECTANGLE_ARB, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_RECTANGLE_ARB, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+#endif
+		}
+		return 0;
+	}
+
 	glGenTextures (1, &_gl_texture_id);
 	glBindTexture (GL_TEXTURE_RECTANGLE_ARB, _gl_texture_id);
 	glTexImage2D (GL_TEXTURE_RECTANGLE_ARB, 0, GL_RGBA,
 			width, height, 0,
 			GL_BGRA, GL_UNSIGNED_BYTE, NULL);
 
-	//TODO use glBindBuffer() // glBindBufferARB()
-
 	glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -107,26 +238,180 @@ static int gl_reallocate_texture(int width, int height) {
 	return 0;
 }
 
+#define GL_PROC(NAME) \
+	if (!(*(void **)(&_gl_fn.NAME) = gl_get_proc_address ("gl" #NAME))) return -1;
+
+static int gl_init_yuv_shader () {
+	GLint status;
+	GLuint shader;
+	const char *ext = (const char *) glGetString (GL_EXTENSIONS);
+	if (!ext || !strstr (ext, "GL_ARB_texture_rectangle")) {
+		return -1;
+	}
+
+	GL_PROC(ActiveTexture);
+	GL_PROC(CreateShader);
+	GL_PROC(ShaderSource);
+	GL_PROC(CompileShader);
+	GL_PROC(GetShaderiv);
+	GL_PROC(DeleteShader);
+	GL_PROC(CreateProgram);
+	GL_PROC(AttachShader);
+	GL_PROC(LinkProgram);
+	GL_PROC(GetProgramiv);
+	GL_PROC(DeleteProgram);
+	GL_PROC(UseProgram);
+	GL_PROC(GetUniformLocation);
+	GL_PROC(Uniform1i);
+
+	shader = _gl_fn.CreateShader (GL_FRAGMENT_SHADER);
+	if (!shader) {
+		return -1;
+	}
+	_gl_fn.ShaderSource (shader, 1, &_gl_yuv_shader, NULL);
+	_gl_fn.CompileShader (shader);
+	_gl_fn.GetShaderiv (shader, GL_COMPILE_STATUS, &status);
+	if (!status) {
+		_gl_fn.DeleteShader (shader);
+		return -1;
+	}
+
+	_gl_yuv_prog = _gl_fn.CreateProgram ();
+	_gl_fn.AttachShader (_gl_yuv_prog, shader);
+	_gl_fn.LinkProgram (_gl_yuv_prog);
+	_gl_fn.DeleteShader (shader); // flagged, freed with the program
+	_gl_fn.GetProgramiv (_gl_yuv_prog, GL_LINK_STATUS, &status);
+	if (!status) {
+		_gl_fn.DeleteProgram (_gl_yuv_prog);
+		_gl_yuv_prog = 0;
+		return -1;
+	}
+
+	_gl_fn.UseProgram (_gl_yuv_prog);
+	_gl_fn.Uniform1i (_gl_fn.GetUniformLocation (_gl_yuv_prog, "tex_y"), 0);
+	_gl_fn.Uniform1i (_gl_fn.GetUniformLocation (_gl_yuv_prog, "tex_u"), 1);
+	_gl_fn.Uniform1i (_gl_fn.GetUniformLocation (_gl_yuv_prog, "tex_v"), 2);
+	_gl_fn.UseProgram (0);
+	return 0;
+}
+
+static int gl_init_pbo () {
+	const char *ext = (const char *) glGetString (GL_EXTENSIONS);
+	if (!ext || !strstr (ext, "GL_ARB_pixel_buffer_object")) {
+		return -1;
+	}
+	GL_PROC(GenBuffers);
+	GL_PROC(DeleteBuffers);
+	GL_PROC(BindBuffer);
+	GL_PROC(BufferData);
+	GL_PROC(MapBuffer);
+	GL_PROC(UnmapBuffer);
+	return 0;
+}
+
+/* copy the frame to the next PBO of the ring. Returns the base pointer
+ * to pass to glTexSubImage2D(): the frame itself if PBOs are not
+ * available, or offset 0 of the (bound) PBO.
+ */
+static const uint8_t *gl_pbo_stage(const uint8_t *surf_data, size_t size) {
+	void *dst;
+	if (!_gl_pbo_ok || size != _gl_pbo_size) {
+		return surf_data;
+	}
+	_gl_pbo_idx = (_gl_pbo_idx + 1) % GL_PBO_COUNT;
+	_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, _gl_pbo[_gl_pbo_idx]);
+	// orphan the storage, rather than waiting for a pending transfer
+	_gl_fn.BufferData (GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	dst = _gl_fn.MapBuffer (GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	if (!dst) {
+		_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+		return surf_data;
+	}
+	memcpy (dst, surf_data, size);
+	if (!_gl_fn.UnmapBuffer (GL_PIXEL_UNPACK_BUFFER)) {
+		// data store was lost, upload directly
+		_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+		return surf_data;
+	}
+	return NULL;
+}
+
+static void gl_pbo_release() {
+	if (_gl_pbo_ok) {
+		_gl_fn.BindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+}
+
 static void gl_init () {
 	glClearColor (0.0f, 0.0f, 0.0f, 0.0f);
 	glDisable (GL_DEPTH_TEST);
 	glEnable (GL_BLEND);
 	glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable (GL_TEXTURE_RECTANGLE_ARB);
+
+	_gl_yuv = 0;
+	if (render_fmt == AV_PIX_FMT_YUV420P) {
+		if (gl_init_yuv_shader ()) {
+			if (!want_quiet)
+				fprintf(stderr, "OpenGL: YUV shader is not available, using BGRA from the decoder.\n");
+			gl_yuv_unavailable = 1;
+		} else {
+			_gl_yuv = 1;
+			if (want_verbose)
+				printf("OpenGL: using YUV shader\n");
+		}
+	}
+
+	// PBOs belong to the previous context, if any
+	memset (_gl_pbo, 0, sizeof (_gl_pbo));
+	_gl_pbo_ok = gl_init_pbo () ? 0 : 1;
+	if (want_verbose && _gl_pbo_ok) {
+		printf("OpenGL: streaming textures via pixel buffer objects\n");
+	}
 }
 
 static void opengl_draw (int width, int height, unsigned char* surf_data) {
+	if (width != _gl_tex_width || height != _gl_tex_height) {
+		// texture storage is allocated once, and updated in place
+		gl_reallocate_texture (width, height);
+	}
+
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 	glClear(GL_COLOR_BUFFER_BIT);
 
+	if (render_fmt == AV_PIX_FMT_YUV420P && !_gl_yuv) {
+		// until the decoder was switched to BGRA
+		return;
+	}
+
 	glPushMatrix ();
 
 	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_RECTANGLE_ARB, _gl_texture_id);
-	glTexImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, GL_RGBA,
-			width, height, /*border*/ 0,
-			GL_BGRA, GL_UNSIGNED_BYTE, surf_data);
+	if (_gl_yuv) {
+		int i;
+		const char *base = (const char *) gl_pbo_stage (surf_data, gl_frame_size (width, height));
+		const void *planes[3] = {
+			base,
+			base + width * height,
+			base + width * height + (width / 2) * (height / 2)
+		};
+		glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+		for (i = 2; i >= 0; --i) {
+			_gl_fn.ActiveTexture (GL_TEXTURE0 + i);
+			glBindTexture(GL_TEXTURE_RECTANGLE_ARB, _gl_yuv_tex[i]);
+			glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, 0, 0,
+					i ? width / 2 : width, i ? height / 2 : height,
+					GL_LUMINANCE, GL_UNSIGNED_BYTE, planes[i]);
+		}
+		_gl_fn.UseProgram (_gl_yuv_prog);
+	} else {
+		glBindTexture(GL_TEXTURE_RECTANGLE_ARB, _gl_texture_id);
+		glTexSubImage2D(GL_TEXTURE_RECTANGLE_ARB, 0, 0, 0,
+				width, height,
+				GL_BGRA, GL_UNSIGNED_BYTE, gl_pbo_stage (surf_data, gl_frame_size (width, height)));
+	}
+	gl_pbo_release ();
 
 	glBegin(GL_QUADS);
 	glTexCoord2f(           0.0f, (GLfloat) height);
@@ -142,17 +427,18 @@ static void opengl_draw (int width, int height, unsigned char* surf_data) {
 	glVertex2f(-_gl_quad_x,  _gl_quad_y);
 	glEnd();
 
+	if (_gl_yuv) {
+		_gl_fn.UseProgram (0);
+	}
 	glDisable(GL_TEXTURE_2D);
 	glPopMatrix();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static void xjglExpose(uint8_t *buf) {
-	if (!buf) buf = buffer;
-	if (!buf) return;
+static void xjglPresent(int width, int height, uint8_t *buf) {
 	gl_make_current();
-	opengl_draw (movie_width, movie_height, buf);
+	opengl_draw (width, height, buf);
 	glFlush();
 	gl_swap_buffers();
 	if (_gl_vblank_sync) {
@@ -161,6 +447,14 @@ static void xjglExpose(uint8_t *buf) {
 	gl_clear_current();
 }
 
+#if (defined PLATFORM_WINDOWS || defined PLATFORM_OSX)
+static void xjglExpose(uint8_t *buf) {
+	if (!buf) buf = buffer;
+	if (!buf) return;
+	xjglPresent (movie_width, movie_height, buf);
+}
+#endif
+
 static void xjglButton(int btn) {
 	switch (btn) {
 		case 2:
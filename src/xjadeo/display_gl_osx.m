@@ -27,6 +27,7 @@ extern double framerate;
 #import <Cocoa/Cocoa.h>
 #include <libgen.h>
 #include <pthread.h>
+#include <dlfcn.h>
 
 static pthread_mutex_t osx_vbuf_lock = PTHREAD_MUTEX_INITIALIZER;
 static size_t          osx_vbuf_size = 0;
@@ -668,6 +669,10 @@ static void gl_swap_buffers () {
 	glSwapAPPLE ();
 }
 
+static void *gl_get_proc_address (const char *proc) {
+	return dlsym (RTLD_DEFAULT, proc);
+}
+
 void gl_newsrc () {
 	pthread_mutex_lock (&osx_vbuf_lock);
 	_newsrc = true;
@@ -69,6 +69,12 @@ static void gl_swap_buffers() {
 	SwapBuffers(_gl_hdc);
 }
 
+static void *win_glGetProcAddress(const char* proc);
+
+static void *gl_get_proc_address(const char *proc) {
+	return win_glGetProcAddress(proc);
+}
+
 void gl_newsrc () {
 	pthread_mutex_lock(&win_vbuf_lock);
 	free(win_vbuf);
@@ -516,30 +522,30 @@ static int check_wgl_extention(const char *ext) {
 	}
 	return 0;
 }
+#endif
 
 static void *win_glGetProcAddress(const char* proc) {
 	void * func = NULL;
 	static int initialized = 0;
 	static HMODULE handle;
-	static void * (*wgl_getProcAddress)(const char *proc);
+	static PROC (WINAPI *wgl_getProcAddress)(LPCSTR proc);
 
 	if (!initialized) {
 		initialized = 1;
 		handle = GetModuleHandle("OPENGL32.DLL");
 		wgl_getProcAddress =
-			(void* (*)(const char*))
+			(PROC (WINAPI *)(LPCSTR))
 			GetProcAddress(handle, "wglGetProcAddress");
 	}
 
 	if (wgl_getProcAddress) {
-		func = wgl_getProcAddress(proc);
+		func = (void*) wgl_getProcAddress(proc);
 	}
-	if (!func) {
-		func = GetProcAddress(NULL, proc);
+	if (!func && handle) {
+		func = (void*) GetProcAddress(handle, proc);
 	}
 	return func;
 }
-#endif
 
 static LRESULT
 handleMessage(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam) {
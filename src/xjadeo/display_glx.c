@@ -20,6 +20,7 @@
 #include "display_gl_common.h"
 #if (defined HAVE_GL && !defined PLATFORM_WINDOWS && !defined PLATFORM_OSX)
 
+#include <pthread.h>
 #include <GL/glx.h>
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
@@ -36,24 +37,137 @@ static Window     _gl_win;
 static GLXContext _gl_ctx;
 
 extern double framerate;  // used for screensaver
+extern int    want_glthread;
+
+/* The GL context is owned by a presenter thread, which draws the
+ * most recent frame and blocks on vblank in glXSwapBuffers().
+ * gl_render() only hands the frame over: triple-buffered, the
+ * renderer never waits for the presenter and vice versa.
+ *
+ * With --no-gl-thread, gl_render() draws and swaps itself, as
+ * before the presenter thread was added.
+ */
+static int             _gl_present_async = 0;
+static pthread_t       _gl_present_thread;
+static pthread_mutex_t _gl_present_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  _gl_present_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t _gl_draw_lock = PTHREAD_MUTEX_INITIALIZER;
+static int             _gl_present_run = 0;
+
+static uint8_t *_gl_pbuf[3] = {NULL, NULL, NULL};
+static size_t   _gl_pbuf_size = 0;
+static int      _gl_pbuf_width = 0;
+static int      _gl_pbuf_height = 0;
+static int      _gl_pwrite = 0; // owned by gl_render()
+static int      _gl_pready = 1; // handed over, protected by _gl_present_lock
+static int      _gl_pread  = 2; // owned by the presenter thread
+static int      _gl_pfresh = 0; // _gl_pready holds a frame not yet presented
+static int      _gl_predraw = 0;
+static int      _gl_preshape = 0;
+static int      _gl_preshape_w, _gl_preshape_h;
 
 static void gl_sync_lock() { }
 static void gl_sync_unlock() { }
 
+// in async mode, the context is current in the presenter thread
 static void gl_make_current() {
-	glXMakeCurrent(_gl_display, _gl_win, _gl_ctx);
+	if (!_gl_present_async)
+		glXMakeCurrent(_gl_display, _gl_win, _gl_ctx);
 }
 
 static void gl_clear_current() {
-	glXMakeCurrent(_gl_display, None, NULL);
+	if (!_gl_present_async)
+		glXMakeCurrent(_gl_display, None, NULL);
 }
 
 static void gl_swap_buffers() {
 	glXSwapBuffers(_gl_display, _gl_win);
 }
 
+static void *gl_get_proc_address(const char *proc) {
+	return (void*) glXGetProcAddress((const GLubyte *)proc);
+}
+
 void gl_newsrc () {
-	gl_reallocate_texture(movie_width, movie_height);
+	int i;
+	if (!_gl_present_async) {
+		gl_make_current();
+		gl_reallocate_texture(movie_width, movie_height);
+		gl_clear_current();
+		return;
+	}
+	pthread_mutex_lock (&_gl_draw_lock);
+	pthread_mutex_lock (&_gl_present_lock);
+	_gl_pbuf_size   = video_buffer_size ();
+	_gl_pbuf_width  = movie_width;
+	_gl_pbuf_height = movie_height;
+	for (i = 0; i < 3; ++i) {
+		free (_gl_pbuf[i]);
+		_gl_pbuf[i] = _gl_pbuf_size > 0 ? calloc (_gl_pbuf_size, sizeof(uint8_t)) : NULL;
+	}
+	_gl_pfresh = 0;
+	pthread_mutex_unlock (&_gl_present_lock);
+	pthread_mutex_unlock (&_gl_draw_lock);
+}
+
+static void *gl_present (void *arg) {
+	glXMakeCurrent (_gl_display, _gl_win, _gl_ctx);
+
+	pthread_mutex_lock (&_gl_present_lock);
+	while (_gl_present_run) {
+		int fresh, reshape;
+		if (!_gl_pfresh && !_gl_predraw && !_gl_preshape) {
+			pthread_cond_wait (&_gl_present_cond, &_gl_present_lock);
+			continue;
+		}
+		pthread_mutex_unlock (&_gl_present_lock);
+
+		pthread_mutex_lock (&_gl_draw_lock);
+		pthread_mutex_lock (&_gl_present_lock);
+		fresh = _gl_pfresh;
+		if (fresh) {
+			const int tmp = _gl_pread;
+			_gl_pread  = _gl_pready;
+			_gl_pready = tmp;
+			_gl_pfresh = 0;
+		}
+		reshape = _gl_preshape;
+		_gl_preshape = 0;
+		_gl_predraw = 0;
+		pthread_mutex_unlock (&_gl_present_lock);
+
+		if (reshape) {
+			gl_reshape (_gl_preshape_w, _gl_preshape_h);
+		}
+		if (_gl_pbuf[_gl_pread]) {
+			xjglPresent (_gl_pbuf_width, _gl_pbuf_height, _gl_pbuf[_gl_pread]);
+		}
+		pthread_mutex_unlock (&_gl_draw_lock);
+
+		if (fresh) {
+			pacing_frame_presented ();
+		}
+		pthread_mutex_lock (&_gl_present_lock);
+	}
+	pthread_mutex_unlock (&_gl_present_lock);
+
+	glXMakeCurrent (_gl_display, None, NULL);
+	return NULL;
+}
+
+static void gl_present_stop () {
+	int i;
+	pthread_mutex_lock (&_gl_present_lock);
+	_gl_present_run = 0;
+	pthread_cond_signal (&_gl_present_cond);
+	pthread_mutex_unlock (&_gl_present_lock);
+	pthread_join (_gl_present_thread, NULL);
+
+	for (i = 0; i < 3; ++i) {
+		free (_gl_pbuf[i]);
+		_gl_pbuf[i] = NULL;
+	}
+	_gl_pbuf_size = 0;
 }
 
 static void glx_netwm(const char *atom, const int onoff) {
@@ -131,6 +245,8 @@ static int check_glx_extention(const char *ext) {
 
 
 int gl_open_window () {
+	// the presenter thread uses the display connection, too,
+	// XInitThreads() was called by main()
 	_gl_display = XOpenDisplay(0);
 	if (!_gl_display) {
 		fprintf( stderr, "Cannot connect to X server\n");
@@ -268,6 +384,21 @@ int gl_open_window () {
 	// https://www.opengl.org/wiki/Swap_Interval#GPU_vs_CPU_synchronization
 	//_gl_vblank_sync = (vblank == 0) ? 1 : 0;
 #endif
+
+	glXMakeCurrent(_gl_display, None, NULL);
+	_gl_present_async = want_glthread;
+	gl_newsrc();
+	if (!_gl_present_async) {
+		return 0;
+	}
+	_gl_present_run = 1;
+	if (pthread_create (&_gl_present_thread, NULL, gl_present, NULL)) {
+		_gl_present_run = 0;
+		if (!want_quiet)
+			fprintf(stderr, "GLX: cannot start presenter thread\n");
+		gl_close_window ();
+		return 1;
+	}
 	return 0;
 }
 
@@ -278,6 +409,10 @@ void gl_close_window() {
 #ifdef XFIB
 	x_fib_close (_gl_display);
 #endif
+	if (_gl_present_run) {
+		gl_present_stop ();
+	}
+	_gl_present_async = 0;
 	glXDestroyContext(_gl_display, _gl_ctx);
 	XDestroyWindow(_gl_display, _gl_win);
 	XCloseDisplay(_gl_display);
@@ -320,13 +455,28 @@ void gl_handle_events () {
 						(event.xconfigure.width != _gl_width || event.xconfigure.height != _gl_height)
 					 )
 				{
-					gl_reshape(event.xconfigure.width, event.xconfigure.height);
+					if (!_gl_present_async) {
+						gl_reshape(event.xconfigure.width, event.xconfigure.height);
+						break;
+					}
+					pthread_mutex_lock (&_gl_present_lock);
+					_gl_preshape_w = event.xconfigure.width;
+					_gl_preshape_h = event.xconfigure.height;
+					_gl_preshape = 1;
+					pthread_cond_signal (&_gl_present_cond);
+					pthread_mutex_unlock (&_gl_present_lock);
 				}
 				break;
 			case Expose:
 				if (event.xexpose.count != 0) {
 					break;
 				}
+				if (_gl_present_async) {
+					pthread_mutex_lock (&_gl_present_lock);
+					_gl_predraw = 1;
+					pthread_cond_signal (&_gl_present_cond);
+					pthread_mutex_unlock (&_gl_present_lock);
+				}
 				_gl_reexpose = true;
 				break;
 			case MotionNotify:
@@ -414,7 +564,25 @@ void gl_handle_events () {
 }
 
 void gl_render (uint8_t *mybuffer) {
-	xjglExpose(NULL);
+	if (!_gl_present_async) {
+		if (!mybuffer) return;
+		xjglPresent (movie_width, movie_height, mybuffer);
+		pacing_frame_presented ();
+		return;
+	}
+	if (!mybuffer || !_gl_pbuf[_gl_pwrite]) return;
+	memcpy (_gl_pbuf[_gl_pwrite], mybuffer, _gl_pbuf_size);
+
+	pthread_mutex_lock (&_gl_present_lock);
+	const int tmp = _gl_pwrite;
+	_gl_pwrite = _gl_pready;
+	_gl_pready = tmp;
+	if (_gl_pfresh) {
+		pacing_frame_skipped ();
+	}
+	_gl_pfresh = 1;
+	pthread_cond_signal (&_gl_present_cond);
+	pthread_mutex_unlock (&_gl_present_lock);
 }
 
 void gl_resize (unsigned int x, unsigned int y) {
@@ -0,0 +1,372 @@
+/* xjadeo - on screen display span kernels
+ *
+ * (C) 2006-2014 Robin Gareus <robin@gareus.org>
+ * (C) 2006-2011 Luis Garrido <luisgarrido@users.sourceforge.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* included by display.c and by contrib/osdbench */
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define OSD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define OSD_NEON
+#endif
+
+extern int movie_width, movie_height;
+
+/* Span kernels, specialized per pixel format: process `n` pixels of
+ * row `dy` starting at column `dx`. Pixels with a value below `min`
+ * are left unmodified. Pixels are processed left to right, which
+ * matters for UYVY where neighbouring pixels share bytes.
+ */
+typedef void (*osd_span) (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min);
+
+typedef struct {
+	osd_span render;
+	osd_span red_render;
+	osd_span overlay;
+} osd_kernels;
+
+#define OSD_BLEND(B, V) (0xff - (((B) >> 1) + ((V) >> 1)))
+
+#ifdef OSD_SSE2
+/* OSD_BLEND() of 16 bytes */
+static inline __m128i osd_blend_sse2 (const __m128i b, const __m128i v) {
+	const __m128i m7f = _mm_set1_epi8 (0x7f);
+	const __m128i s = _mm_add_epi8 (
+			_mm_and_si128 (_mm_srli_epi16 (b, 1), m7f),
+			_mm_and_si128 (_mm_srli_epi16 (v, 1), m7f));
+	return _mm_xor_si128 (s, _mm_set1_epi8 ((char)0xff));
+}
+
+/* OSD_BLEND() of 8 16bit words, the high bytes are zero */
+static inline __m128i osd_blend16_sse2 (const __m128i b, const __m128i v) {
+	return _mm_sub_epi16 (_mm_set1_epi16 (0xff),
+			_mm_add_epi16 (_mm_srli_epi16 (b, 1), _mm_srli_epi16 (v, 1)));
+}
+
+/* 0xff for every byte of v >= min */
+static inline __m128i osd_mask_sse2 (const __m128i v, const __m128i vmin) {
+	return _mm_cmpeq_epi8 (_mm_max_epu8 (v, vmin), v);
+}
+
+/* m ? a : b */
+static inline __m128i osd_select_sse2 (const __m128i m, const __m128i a, const __m128i b) {
+	return _mm_or_si128 (_mm_and_si128 (m, a), _mm_andnot_si128 (m, b));
+}
+#endif
+
+#ifdef OSD_NEON
+/* OSD_BLEND() of 16 bytes */
+static inline uint8x16_t osd_blend_neon (const uint8x16_t b, const uint8x16_t v) {
+	return vmvnq_u8 (vaddq_u8 (vshrq_n_u8 (b, 1), vshrq_n_u8 (v, 1)));
+}
+#endif
+
+/* Every pixel blends the luma of its own and of the following
+ * UYVY sample. So luma `k` of the span is blended with val[k-1]
+ * and then with val[k].
+ */
+static void _overlay_YUV422 (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t * const p = mybuffer + 2 * dx + movie_width * dy * 2;
+	int k;
+	if (n <= 0) return;
+	if (val[0] >= min) p[1] = OSD_BLEND(p[1], val[0]);
+	k = 1;
+#if defined OSD_SSE2
+	{
+		const __m128i vmin = _mm_set1_epi16 ((short)min - 1);
+		const __m128i zero = _mm_setzero_si128 ();
+		const __m128i chroma = _mm_set1_epi16 (0x00ff);
+		for (; k + 8 <= n; k += 8) {
+			const __m128i q   = _mm_loadu_si128 ((const __m128i*)(p + 2 * k));
+			const __m128i lum = _mm_srli_epi16 (q, 8);
+			const __m128i prv = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)(val + k - 1)), zero);
+			const __m128i cur = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i*)(val + k)), zero);
+			const __m128i t = osd_select_sse2 (_mm_cmpgt_epi16 (prv, vmin), osd_blend16_sse2 (lum, prv), lum);
+			const __m128i r = osd_select_sse2 (_mm_cmpgt_epi16 (cur, vmin), osd_blend16_sse2 (t, cur), t);
+			_mm_storeu_si128 ((__m128i*)(p + 2 * k), _mm_or_si128 (_mm_and_si128 (q, chroma), _mm_slli_epi16 (r, 8)));
+		}
+	}
+#elif defined OSD_NEON
+	{
+		const uint8x16_t vmin = vdupq_n_u8 (min);
+		for (; k + 16 <= n; k += 16) {
+			uint8x16x2_t q = vld2q_u8 (p + 2 * k);
+			const uint8x16_t prv = vld1q_u8 (val + k - 1);
+			const uint8x16_t cur = vld1q_u8 (val + k);
+			const uint8x16_t t = vbslq_u8 (vcgeq_u8 (prv, vmin), osd_blend_neon (q.val[1], prv), q.val[1]);
+			q.val[1] = vbslq_u8 (vcgeq_u8 (cur, vmin), osd_blend_neon (t, cur), t);
+			vst2q_u8 (p + 2 * k, q);
+		}
+	}
+#endif
+	for (; k < n; ++k) {
+		uint8_t * const l = p + 2 * k + 1;
+		if (val[k - 1] >= min) *l = OSD_BLEND(*l, val[k - 1]);
+		if (val[k] >= min)     *l = OSD_BLEND(*l, val[k]);
+	}
+	if (val[n - 1] >= min) p[2 * n + 1] = OSD_BLEND(p[2 * n + 1], val[n - 1]);
+}
+
+static void _overlay_YUV (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t * const y = mybuffer + dx + movie_width * dy;
+	int i = 0;
+#if defined OSD_SSE2
+	const __m128i vmin = _mm_set1_epi8 ((char)min);
+	for (; i + 16 <= n; i += 16) {
+		const __m128i v = _mm_loadu_si128 ((const __m128i*)(val + i));
+		const __m128i b = _mm_loadu_si128 ((const __m128i*)(y + i));
+		_mm_storeu_si128 ((__m128i*)(y + i), osd_select_sse2 (osd_mask_sse2 (v, vmin), osd_blend_sse2 (b, v), b));
+	}
+#elif defined OSD_NEON
+	const uint8x16_t vmin = vdupq_n_u8 (min);
+	for (; i + 16 <= n; i += 16) {
+		const uint8x16_t v = vld1q_u8 (val + i);
+		const uint8x16_t b = vld1q_u8 (y + i);
+		vst1q_u8 (y + i, vbslq_u8 (vcgeq_u8 (v, vmin), osd_blend_neon (b, v), b));
+	}
+#endif
+	for (; i < n; ++i) {
+		if (val[i] >= min) y[i] = OSD_BLEND(y[i], val[i]);
+	}
+}
+
+static void _render_YUV422 (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t *p = mybuffer + 2 * dx + movie_width * dy * 2;
+	int i;
+	for (i = 0; i < n; ++i, p += 2) {
+		if (val[i] < min) continue;
+		p[0] = 0x80;
+		p[1] = val[i];
+		p[2] = 0x80;
+		p[3] = val[i];
+	}
+}
+
+static void _render_YUV (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t * const y = mybuffer + dx + movie_width * dy;
+	uint8_t * const u = mybuffer + movie_width * movie_height + movie_width / 2 * (dy / 2);
+	uint8_t * const v = u + movie_width * movie_height / 4;
+	int i = 0;
+	if (n <= 0) return;
+	if (min == 0) {
+		memcpy (y, val, n);
+		memset (u + dx / 2, 0x80, (dx + n - 1) / 2 - dx / 2 + 1);
+		memset (v + dx / 2, 0x80, (dx + n - 1) / 2 - dx / 2 + 1);
+		return;
+	}
+	if (dx & 1) {
+		// align to the chroma sub-sampling
+		if (val[0] >= min) {
+			y[0] = val[0];
+			u[dx / 2] = 0x80;
+			v[dx / 2] = 0x80;
+		}
+		i = 1;
+	}
+#if defined OSD_SSE2
+	{
+		const __m128i vmin = _mm_set1_epi8 ((char)min);
+		const __m128i c80  = _mm_set1_epi8 ((char)0x80);
+		for (; i + 32 <= n; i += 32) {
+			uint8_t * const uc = u + (dx + i) / 2;
+			uint8_t * const vc = v + (dx + i) / 2;
+			const __m128i v0 = _mm_loadu_si128 ((const __m128i*)(val + i));
+			const __m128i v1 = _mm_loadu_si128 ((const __m128i*)(val + i + 16));
+			const __m128i m0 = osd_mask_sse2 (v0, vmin);
+			const __m128i m1 = osd_mask_sse2 (v1, vmin);
+			// a chroma sample is set if either of its two pixels is
+			const __m128i c0 = _mm_srli_epi16 (_mm_or_si128 (m0, _mm_slli_epi16 (m0, 8)), 8);
+			const __m128i c1 = _mm_srli_epi16 (_mm_or_si128 (m1, _mm_slli_epi16 (m1, 8)), 8);
+			const __m128i cm = _mm_packus_epi16 (c0, c1);
+			_mm_storeu_si128 ((__m128i*)(y + i),      osd_select_sse2 (m0, v0, _mm_loadu_si128 ((const __m128i*)(y + i))));
+			_mm_storeu_si128 ((__m128i*)(y + i + 16), osd_select_sse2 (m1, v1, _mm_loadu_si128 ((const __m128i*)(y + i + 16))));
+			_mm_storeu_si128 ((__m128i*)uc, osd_select_sse2 (cm, c80, _mm_loadu_si128 ((const __m128i*)uc)));
+			_mm_storeu_si128 ((__m128i*)vc, osd_select_sse2 (cm, c80, _mm_loadu_si128 ((const __m128i*)vc)));
+		}
+	}
+#elif defined OSD_NEON
+	{
+		const uint8x16_t vmin = vdupq_n_u8 (min);
+		const uint8x16_t c80  = vdupq_n_u8 (0x80);
+		for (; i + 32 <= n; i += 32) {
+			uint8_t * const uc = u + (dx + i) / 2;
+			uint8_t * const vc = v + (dx + i) / 2;
+			const uint8x16x2_t vv = vld2q_u8 (val + i);
+			const uint8x16_t me = vcgeq_u8 (vv.val[0], vmin);
+			const uint8x16_t mo = vcgeq_u8 (vv.val[1], vmin);
+			const uint8x16_t cm = vorrq_u8 (me, mo);
+			uint8x16x2_t yy = vld2q_u8 (y + i);
+			yy.val[0] = vbslq_u8 (me, vv.val[0], yy.val[0]);
+			yy.val[1] = vbslq_u8 (mo, vv.val[1], yy.val[1]);
+			vst2q_u8 (y + i, yy);
+			vst1q_u8 (uc, vbslq_u8 (cm, c80, vld1q_u8 (uc)));
+			vst1q_u8 (vc, vbslq_u8 (cm, c80, vld1q_u8 (vc)));
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		if (val[i] < min) continue;
+		y[i] = val[i];
+		u[(dx + i) / 2] = 0x80;
+		v[(dx + i) / 2] = 0x80;
+	}
+}
+
+static void _red_render_YUV422 (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t * const row = mybuffer + movie_width * dy * 2;
+	int i;
+	for (i = 0; i < n; ++i) {
+		const int x = dx + i;
+		uint8_t * const p = row + 2 * (x & ~1);
+		if (val[i] < min) continue;
+		if (val[i] > 0x10) {
+			p[0] = 0x40;
+			p[2] = 0xb0;
+		}
+		if (x % 2)
+			p[3] = val[i] >> 1;
+		else
+			p[1] = val[i] >> 1;
+	}
+}
+
+static void _red_render_YUV (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t * const y = mybuffer + dx + movie_width * dy;
+	uint8_t * const u = mybuffer + movie_width * movie_height + movie_width / 2 * (dy / 2);
+	uint8_t * const v = u + movie_width * movie_height / 4;
+	int i;
+	for (i = 0; i < n; ++i) {
+		if (val[i] < min) continue;
+		y[i] = val[i] > 0x90 ? 0x90 : val[i];
+		u[(dx + i) / 2] = val[i] > 0x10 ? 0x50 : 0x80;
+		v[(dx + i) / 2] = val[i] > 0x10 ? 0xc0 : 0x80;
+	}
+}
+
+static void _overlay_RGB3 (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t *p = mybuffer + 3 * (dx + movie_width * dy);
+	int i = 0;
+#if defined OSD_SSE2
+	const __m128i vmin = _mm_set1_epi8 ((char)min);
+	for (; i + 16 <= n; i += 16, p += 48) {
+		// no byte shuffle in SSE2, expand 16 pixels to 48 bytes
+		uint8_t e[48];
+		int j;
+		for (j = 0; j < 16; ++j) {
+			e[3 * j] = e[3 * j + 1] = e[3 * j + 2] = val[i + j];
+		}
+		for (j = 0; j < 48; j += 16) {
+			const __m128i v = _mm_loadu_si128 ((const __m128i*)(e + j));
+			const __m128i b = _mm_loadu_si128 ((const __m128i*)(p + j));
+			_mm_storeu_si128 ((__m128i*)(p + j), osd_select_sse2 (osd_mask_sse2 (v, vmin), osd_blend_sse2 (b, v), b));
+		}
+	}
+#elif defined OSD_NEON
+	const uint8x16_t vmin = vdupq_n_u8 (min);
+	for (; i + 16 <= n; i += 16, p += 48) {
+		const uint8x16_t v = vld1q_u8 (val + i);
+		const uint8x16_t m = vcgeq_u8 (v, vmin);
+		uint8x16x3_t b = vld3q_u8 (p);
+		b.val[0] = vbslq_u8 (m, osd_blend_neon (b.val[0], v), b.val[0]);
+		b.val[1] = vbslq_u8 (m, osd_blend_neon (b.val[1], v), b.val[1]);
+		b.val[2] = vbslq_u8 (m, osd_blend_neon (b.val[2], v), b.val[2]);
+		vst3q_u8 (p, b);
+	}
+#endif
+	for (; i < n; ++i, p += 3) {
+		if (val[i] < min) continue;
+		p[0] = OSD_BLEND(p[0], val[i]);
+		p[1] = OSD_BLEND(p[1], val[i]);
+		p[2] = OSD_BLEND(p[2], val[i]);
+	}
+}
+
+/* the 4th byte (alpha or padding) is left as-is */
+static void _overlay_RGB4 (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) {
+	uint8_t *p = mybuffer + 4 * (dx + movie_width * dy);
+	int i = 0;
+#if defined OSD_SSE2
+	const __m128i vmin = _mm_set1_epi8 ((char)min);
+	const __m128i rgb  = _mm_set1_epi32 (0x00ffffff);
+	for (; i + 4 <= n; i += 4, p += 16) {
+		int32_t v4;
+		memcpy (&v4, val + i, 4);
+		__m128i v = _mm_cvtsi32_si128 (v4);
+		v = _mm_unpacklo_epi8 (v, v);
+		v = _mm_unpacklo_epi16 (v, v);
+		const __m128i b = _mm_loadu_si128 ((const __m128i*)p);
+		const __m128i m = _mm_and_si128 (osd_mask_sse2 (v, vmin), rgb);
+		_mm_storeu_si128 ((__m128i*)p, osd_select_sse2 (m, osd_blend_sse2 (b, v), b));
+	}
+#elif defined OSD_NEON
+	const uint8x16_t vmin = vdupq_n_u8 (min);
+	for (; i + 16 <= n; i += 16, p += 64) {
+		const uint8x16_t v = vld1q_u8 (val + i);
+		const uint8x16_t m = vcgeq_u8 (v, vmin);
+		uint8x16x4_t b = vld4q_u8 (p);
+		b.val[0] = vbslq_u8 (m, osd_blend_neon (b.val[0], v), b.val[0]);
+		b.val[1] = vbslq_u8 (m, osd_blend_neon (b.val[1], v), b.val[1]);
+		b.val[2] = vbslq_u8 (m, osd_blend_neon (b.val[2], v), b.val[2]);
+		vst4q_u8 (p, b);
+	}
+#endif
+	for (; i < n; ++i, p += 4) {
+		if (val[i] < min) continue;
+		p[0] = OSD_BLEND(p[0], val[i]);
+		p[1] = OSD_BLEND(p[1], val[i]);
+		p[2] = OSD_BLEND(p[2], val[i]);
+	}
+}
+
+/* packed RGB, BPP bytes per pixel */
+#define OSD_RGB_KERNELS(BPP) \
+static void _render_RGB##BPP (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) { \
+	uint8_t *p = mybuffer + BPP * (dx + movie_width * dy); \
+	int i; \
+	for (i = 0; i < n; ++i, p += BPP) { \
+		if (val[i] < min) continue; \
+		p[0] = val[i]; \
+		p[1] = val[i]; \
+		p[2] = val[i]; \
+	} \
+} \
+\
+static void _red_render_RGB##BPP (uint8_t *mybuffer, const int dx, const int dy, const uint8_t *val, const int n, const uint8_t min) { \
+	uint8_t *p = mybuffer + BPP * (dx + movie_width * dy); \
+	int i; \
+	for (i = 0; i < n; ++i, p += BPP) { \
+		if (val[i] < min) continue; \
+		p[0] = val[i] >> 2; \
+		p[1] = val[i] >> 2; \
+		p[2] = val[i]; \
+	} \
+}
+
+OSD_RGB_KERNELS(3)
+OSD_RGB_KERNELS(4)
+
+static const osd_kernels osd_YUV    = { &_render_YUV,    &_red_render_YUV,    &_overlay_YUV };
+static const osd_kernels osd_YUV422 = { &_render_YUV422, &_red_render_YUV422, &_overlay_YUV422 };
+static const osd_kernels osd_RGB3   = { &_render_RGB3,   &_red_render_RGB3,   &_overlay_RGB3 };
+static const osd_kernels osd_RGB4   = { &_render_RGB4,   &_red_render_RGB4,   &_overlay_RGB4 };
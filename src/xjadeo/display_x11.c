@@ -216,6 +216,8 @@ void xj_letterbox () {
 #ifdef HAVE_LIBXV
 static int xv_set_eq(char *name, int value);
 static int xv_get_eq(char *name, int *value);
+static void xv_expose(void);
+static int xv_handle_completion(XEvent *event);
 #endif
 #ifdef HAVE_IMLIB2
 static int im2_get_eq(char *name, int *value);
@@ -223,6 +225,12 @@ static int im2_set_eq(char *name, int value);
 #endif
 
 static inline void xj_render () {
+#ifdef HAVE_LIBXV
+	if (getvidmode() == VO_XV) {
+		xv_expose();
+		return;
+	}
+#endif
 	VO[getvidmode()].render(buffer);
 }
 
@@ -270,6 +278,9 @@ static void xj_handle_X_events (void) {
 	int value = 0; // used for color-eq
 	while(XPending(xj_dpy)) {
 		XNextEvent(xj_dpy, &event);
+#ifdef HAVE_LIBXV
+		if (getvidmode() == VO_XV && xv_handle_completion(&event)) continue;
+#endif
 #ifdef XDLG
 		if (handle_xdlg_event(xj_dpy, &event)) continue;
 #endif
@@ -556,51 +567,146 @@ static void xj_handle_X_events (void) {
 static int              xv_swidth;
 static int              xv_sheight;
 static XvPortID         xv_port;
-static XShmSegmentInfo  xv_shminfo;
-static XvImage         *xv_image;
 
-static char   *xv_buffer;
-static size_t  xv_len;
-static int     xv_one_memcpy = 0;
+/* Images are rotated, and only re-used after the X server signalled
+ * (XShmCompletionEvent) that it's done reading them. If the image
+ * layout matches xjadeo's YUV420P buffer, frames are decoded directly
+ * into the next image (see redirect_moviebuffer()), otherwise they are
+ * copied.
+ */
+#define XV_NIMAGES 3
+static XShmSegmentInfo  xv_shminfo[XV_NIMAGES];
+static XvImage         *xv_image[XV_NIMAGES];
+static int              xv_busy[XV_NIMAGES];
+static int              xv_cur = 0;    // image to fill next
+static int              xv_shown = -1; // image on screen
+static int              xv_direct = 0;
+static int              xv_completion_type = -1;
+
 static int     xv_pic_format = FOURCC_I420;
 
-static void allocate_xvimage (void) {
-	// YV12 has 12 bits per pixel. 8bitY 2+2 UV
-	xv_len = movie_width * movie_height * 3 / 2 ;
-
-	/* shared memory allocation etc.  */
-	xv_image = XvShmCreateImage(xj_dpy, xv_port,
-		xv_pic_format, NULL, // FIXME: use xjadeo buffer directly
-		xv_swidth, xv_sheight, //768, 486, //720, 576,
-		&xv_shminfo);
-
-	/* TODO: check that this does not break support for some VIC's
-	 * let's ship xjadeo w/ xv_one_memcpy=0; - slower(?) but safer(!)
-	 * (maybe the U/V planes are swapped, byte order or whatever...)
-	 */
-#if 0
-	if (xv_len != xv_image->data_size) xv_one_memcpy =0; else xv_one_memcpy=1;
-#else
-	xv_one_memcpy=0;
+static int xv_handle_completion (XEvent *event) {
+	int i;
+	if (event->type != xv_completion_type) {
+		return 0;
+	}
+	XShmCompletionEvent *ce = (XShmCompletionEvent*) event;
+	for (i = 0; i < XV_NIMAGES; ++i) {
+		if (xv_image[i] && ce->shmseg == xv_shminfo[i].shmseg && xv_busy[i] > 0) {
+			--xv_busy[i];
+		}
+	}
+	return 1;
+}
+
+static Bool xv_is_completion (Display *dpy, XEvent *event, XPointer arg) {
+	return event->type == xv_completion_type;
+}
+
+static void xv_poll_completion (void) {
+	XEvent event;
+	while (XCheckIfEvent(xj_dpy, &event, xv_is_completion, NULL)) {
+		xv_handle_completion (&event);
+	}
+}
+
+/* find an image that the X server is done with, without sleeping:
+ * check the queued events, if all images are still in use, XSync()
+ * once. After that round-trip the server has processed every
+ * XvShmPutImage and queued its completion, so an image that is still
+ * marked busy lost its event.
+ * returns -1 if there is no image to fill (the frame is dropped).
+ */
+static int xv_next_image (void) {
+	int k, i;
+	xv_poll_completion ();
+	for (k = 1; k <= XV_NIMAGES; ++k) {
+		i = (xv_shown + k) % XV_NIMAGES;
+		if (i != xv_shown && xv_image[i] && xv_busy[i] == 0) return i;
+	}
+	XSync(xj_dpy, False);
+	xv_poll_completion ();
+	for (k = 1; k <= XV_NIMAGES; ++k) {
+		i = (xv_shown + k) % XV_NIMAGES;
+		if (i == xv_shown || !xv_image[i]) continue;
+		if (xv_busy[i] > 0) {
+			if (want_verbose)
+				fprintf(stderr, "Xv: no completion event for image %d\n", i);
+			xv_busy[i] = 0;
+		}
+		return i;
+	}
+	return -1;
+}
+
+static int xv_image_is_packed (XvImage *img) {
+	// same layout as avpicture_fill() for YUV420P
+	const int Ylen = movie_width * movie_height;
+#ifdef CROPIMG
+	return 0;
 #endif
+	if (xv_pic_format != FOURCC_I420 || img->num_planes != 3) return 0;
+	if (img->data_size < Ylen * 3 / 2) return 0;
+	if (img->offsets[0] != 0 || img->pitches[0] != movie_width) return 0;
+	if (img->offsets[1] != Ylen || img->pitches[1] != movie_width / 2) return 0;
+	if (img->offsets[2] != Ylen + Ylen / 4 || img->pitches[2] != movie_width / 2) return 0;
+	return 1;
+}
+
+static void allocate_xvimage (void) {
+	int i;
+	xv_direct = 1;
+	for (i = 0; i < XV_NIMAGES; ++i) {
+		xv_image[i] = XvShmCreateImage(xj_dpy, xv_port,
+				xv_pic_format, NULL,
+				xv_swidth, xv_sheight,
+				&xv_shminfo[i]);
+		if (!xv_image[i]) {
+			xv_direct = 0;
+			continue;
+		}
 
-	xv_len =  xv_image->data_size;
-	xv_shminfo.shmid = shmget(IPC_PRIVATE, xv_len, IPC_CREAT | 0777);
-	xv_image->data = xv_buffer = xv_shminfo.shmaddr = shmat(xv_shminfo.shmid, 0, 0);
+		xv_shminfo[i].shmid = shmget(IPC_PRIVATE, xv_image[i]->data_size, IPC_CREAT | 0777);
+		xv_image[i]->data = xv_shminfo[i].shmaddr = shmat(xv_shminfo[i].shmid, 0, 0);
+		xv_shminfo[i].readOnly = False;
+		xv_busy[i] = 0;
 
-	XShmAttach(xj_dpy, &xv_shminfo);
+		XShmAttach(xj_dpy, &xv_shminfo[i]);
+
+		if (!xv_image_is_packed (xv_image[i])) {
+			xv_direct = 0;
+		}
+	}
 	XSync(xj_dpy, False);
 
-	if (xv_shminfo.shmid > 0)
-		shmctl (xv_shminfo.shmid, IPC_RMID, 0);
+	for (i = 0; i < XV_NIMAGES; ++i) {
+		if (xv_image[i] && xv_shminfo[i].shmid > 0)
+			shmctl (xv_shminfo[i].shmid, IPC_RMID, 0);
+	}
+	xv_cur = 0;
+	xv_shown = -1;
+	if (want_verbose)
+		printf("Xv: %d images, %s\n", XV_NIMAGES, xv_direct ? "decoding in place" : "copying frames");
 }
 
 static void deallocate_xvimage(void) {
-	XShmDetach(xj_dpy, &xv_shminfo);
-	shmdt(xv_shminfo.shmaddr);
-	XFree(xv_image);
+	int i;
+	// decode into xjadeo's buffer again
+	redirect_moviebuffer (NULL);
+	// the server is done with all images after this round-trip
 	XSync(xj_dpy, False);
-	xv_buffer=NULL;
+	xv_poll_completion ();
+	for (i = 0; i < XV_NIMAGES; ++i) {
+		if (!xv_image[i]) continue;
+		xv_busy[i] = 0;
+		XShmDetach(xj_dpy, &xv_shminfo[i]);
+		shmdt(xv_shminfo[i].shmaddr);
+		XFree(xv_image[i]);
+		xv_image[i] = NULL;
+	}
+	XSync(xj_dpy, False);
+	xv_direct = 0;
+	xv_shown = -1;
 }
 
 static inline void xv_draw_colorkey(void) {
@@ -615,74 +721,103 @@ static inline void xv_draw_colorkey(void) {
 	}
 }
 
-void render_xv (uint8_t *mybuffer) {
+static void xv_put (int i) {
+	XvShmPutImage(xj_dpy, xv_port,
+		xj_win, xj_gc,
+		xv_image[i],
+		0, 0,				/* sx, sy */
+		xv_swidth, xv_sheight,		/* sw, sh */
+#if 1 // letterbox
+		xj_box[0],xj_box[1],xj_box[2],xj_box[3],
+#else
+		0, 0,				/* dx, dy */
+		xj_dwidth, xj_dheight,		/* dw, dh */
+#endif
+		True);
+	++xv_busy[i];
+	XFlush(xj_dpy);
+}
+
+/* re-display the current image, e.g. after an expose event */
+static void xv_expose (void) {
+	if (xv_shown < 0 || !xv_image[xv_shown]) {
+		render_xv (buffer);
+		return;
+	}
+	xv_draw_colorkey();
+	xv_put (xv_shown);
+}
 
-	if (!xv_buffer || !mybuffer) return;
+void render_xv (uint8_t *mybuffer) {
+	XvImage *img = xv_cur < 0 ? NULL : xv_image[xv_cur];
+	if (!mybuffer) return;
+	if (!img || xv_busy[xv_cur] > 0) {
+		// all images are in use, drop the frame
+		xv_cur = xv_next_image ();
+		if (xv_cur < 0 || !xv_image[xv_cur]) return;
+		img = xv_image[xv_cur];
+		if (mybuffer == (uint8_t*) img->data) return;
+	}
 	xv_draw_colorkey(); // TODO: only redraw on resize ?
 
-	size_t Ylen  = movie_width * movie_height;
-	size_t UVlen = movie_width * movie_height/4;
-	size_t mw2 = movie_width /2;
-	size_t mh2 = movie_height /2;
+	if (mybuffer != (uint8_t*) img->data) {
+		char *xv_buffer = img->data;
+		size_t Ylen  = movie_width * movie_height;
+		size_t UVlen = movie_width * movie_height/4;
+		size_t mw2 = movie_width /2;
+		size_t mh2 = movie_height /2;
 
 #ifdef CROPIMG
-	Ylen*=2;
-	UVlen*=2;
-	mw2*=2;
-	size_t stride = xv_swidth*2; // XXX
+		Ylen*=2;
+		UVlen*=2;
+		mw2*=2;
+		size_t stride = xv_swidth*2; // XXX
 #else
-	size_t stride = xv_swidth;
+		size_t stride = xv_swidth;
 #endif
-	// decode ffmpeg - YUV
-	uint8_t *Yptr=mybuffer; // Y
-	uint8_t *Uptr=Yptr + Ylen; // U
-	uint8_t *Vptr=Uptr + UVlen; // V
+		// decode ffmpeg - YUV
+		uint8_t *Yptr=mybuffer; // Y
+		uint8_t *Uptr=Yptr + Ylen; // U
+		uint8_t *Vptr=Uptr + UVlen; // V
 
 #ifdef CROPIMG
-	Yptr+= xoffset;
-	Uptr+= xoffset/2;
-	Vptr+= xoffset/2;
+		Yptr+= xoffset;
+		Uptr+= xoffset/2;
+		Vptr+= xoffset/2;
 #endif
-	if (xv_pic_format == FOURCC_I420 && xv_one_memcpy) {
-		// copy YUV420P
-		memcpy(xv_buffer,mybuffer,Ylen+UVlen+UVlen); // Y+U+V
-	} else if (xv_pic_format == FOURCC_I420) {
-	
-	// encode YV420P
-		stride_memcpy(xv_buffer+xv_image->offsets[0],
-			Yptr, xv_swidth, xv_sheight, xv_image->pitches[0], stride);
+		if (xv_pic_format == FOURCC_I420) {
+		// encode YV420P
+			stride_memcpy(xv_buffer+img->offsets[0],
+				Yptr, xv_swidth, xv_sheight, img->pitches[0], stride);
 
-		stride_memcpy(xv_buffer+xv_image->offsets[1],
-			Uptr, mw2, mh2, xv_image->pitches[1], mw2);
+			stride_memcpy(xv_buffer+img->offsets[1],
+				Uptr, mw2, mh2, img->pitches[1], mw2);
 
-		stride_memcpy(xv_buffer+xv_image->offsets[2],
-			Vptr, mw2, mh2, xv_image->pitches[2], mw2);
-	} else {
-	// encode YV12
-		stride_memcpy(xv_buffer+xv_image->offsets[0],
-			Yptr, xv_swidth, xv_sheight, xv_image->pitches[0], stride);
+			stride_memcpy(xv_buffer+img->offsets[2],
+				Vptr, mw2, mh2, img->pitches[2], mw2);
+		} else {
+		// encode YV12
+			stride_memcpy(xv_buffer+img->offsets[0],
+				Yptr, xv_swidth, xv_sheight, img->pitches[0], stride);
 
-		stride_memcpy(xv_buffer+xv_image->offsets[1],
-			Vptr, mw2, mh2, xv_image->pitches[1], mw2);
+			stride_memcpy(xv_buffer+img->offsets[1],
+				Vptr, mw2, mh2, img->pitches[1], mw2);
 
-		stride_memcpy(xv_buffer+xv_image->offsets[2],
-			Uptr, mw2, mh2, xv_image->pitches[2], mw2);
+			stride_memcpy(xv_buffer+img->offsets[2],
+				Uptr, mw2, mh2, img->pitches[2], mw2);
+		}
 	}
 
-	XvShmPutImage(xj_dpy, xv_port,
-		xj_win, xj_gc,
-		xv_image,
-		0, 0,				/* sx, sy */
-		xv_swidth, xv_sheight,		/* sw, sh */
-#if 1 // letterbox
-		xj_box[0],xj_box[1],xj_box[2],xj_box[3],
-#else
-		0, 0,				/* dx, dy */
-		xj_dwidth, xj_dheight,		/* dw, dh */
-#endif
-		True);
-	XFlush(xj_dpy);
-// 	XSync(xj_dpy,False);
+	xv_put (xv_cur);
+	xv_shown = xv_cur;
+
+	// don't overwrite an image the X server is still reading
+	xv_cur = xv_next_image ();
+	if (xv_direct && xv_cur >= 0) {
+		redirect_moviebuffer ((uint8_t*) xv_image[xv_cur]->data);
+	} else if (xv_direct) {
+		redirect_moviebuffer (NULL);
+	}
 }
 
 void newsrc_xv (void) {
@@ -846,6 +981,7 @@ int open_window_xv (void) {
 	xj_screen = DefaultScreen(xj_dpy);
 
 	if (!XShmQueryExtension(xj_dpy)) return 1;
+	xv_completion_type = XShmGetEventBase(xj_dpy) + ShmCompletion;
 
 	/* So let's first check for an available adaptor and port */
 	if(Success != XvQueryAdaptors(xj_dpy, xj_rwin, &ad_cnt, &ad_info)) {
@@ -1010,12 +1146,7 @@ void close_window_xv(void) {
 	x_fib_close (xj_dpy);
 #endif
 	XvStopVideo(xj_dpy, xv_port, xj_win);
-	if(xv_shminfo.shmaddr) {
-		XShmDetach(xj_dpy, &xv_shminfo);
-		shmdt(xv_shminfo.shmaddr);
-	}
-	if(xv_image) XFree(xv_image);
-	XSync(xj_dpy, False);
+	deallocate_xvimage();
 	XFreeGC(xj_dpy, xj_gc);
 #if 1
 	if (!loop_flag)
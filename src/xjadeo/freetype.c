@@ -25,8 +25,16 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
-/* origin is the upper left corner */
-unsigned char ST_image[ST_HEIGHT][ST_WIDTH];
+#ifndef MIN
+#define MIN(A,B) (((A)<(B)) ? (A) : (B))
+#endif
+#ifndef MAX
+#define MAX(A,B) (((A)>(B)) ? (A) : (B))
+#endif
+
+/* origin is the upper left corner,
+ * points to the canvas of the most recently rendered text */
+unsigned char (*ST_image)[ST_WIDTH] = NULL;
 int ST_rightend=0;
 int ST_height=0;
 int ST_top = 0;
@@ -67,13 +75,25 @@ EXTLD(fonts_ArdourMono_ttf)
 
 #endif // embedded font file
 
-static void draw_bitmap(FT_Bitmap*  bitmap,
+/* A glyph bitmap to be drawn at the given pen position, either
+ * from the glyph cache or freshly rendered into the face's slot.
+ */
+typedef struct {
+	const unsigned char *buffer;
+	int pitch;
+	int width, rows;
+	int left, top;
+	FT_Pos advance_x, advance_y;
+} ST_Glyph;
+
+static void draw_bitmap(unsigned char (*image)[ST_WIDTH],
+    const ST_Glyph *g,
     FT_Int x,
     FT_Int y)
 {
 	FT_Int i, j, p, q;
-	FT_Int x_max = x + bitmap->width;
-	FT_Int y_max = y + bitmap->rows;
+	FT_Int x_max = x + g->width;
+	FT_Int y_max = y + g->rows;
 
 
 	for (i = x, p = 0; i < x_max; i++, p++)
@@ -83,7 +103,7 @@ static void draw_bitmap(FT_Bitmap*  bitmap,
 			if (i >= ST_WIDTH || j >= ST_HEIGHT || i < 0 || j < 0)
 				continue;
 
-			ST_image[j][i] |= bitmap->buffer[q * bitmap->width + p];
+			image[j][i] |= g->buffer[q * g->pitch + p];
 		}
 	}
 }
@@ -93,21 +113,328 @@ static int   initialized = 0;
 static FT_Library    library;
 static FT_Face       face;
 
-int render_font (char *fontfile, char *text, int px, int dx)
-{
-	static int pxx = 0;
-	FT_GlyphSlot  slot;
-	FT_Matrix     matrix;                 /* transformation matrix */
-	FT_Vector     pen;                    /* untransformed origin  */
-	FT_Error      error;
-	int           target_height;
-	int           n, num_chars;
+/* the pen position in cartesian space coordinates; */
+#define ST_PEN_X (1  * 64)
+#define ST_PEN_Y (10 * 64)
 
-	/* set up matrix */
+/* Glyphs of the current face and size are rasterized once.
+ * FreeType renders the outline translated by the pen position. For
+ * whole-pixel pen positions that is the same bitmap, only moved,
+ * so cached glyphs are rendered at the origin and shifted when drawn.
+ * Glyphs at fractional positions are rendered every time.
+ */
+struct ST_CachedGlyph {
+	int state; // 0: not loaded, 1: cached, -1: no such glyph
+	unsigned char *buffer;
+	int width, rows;
+	int left, top;
+	FT_Pos advance_x, advance_y;
+};
+
+static struct ST_CachedGlyph glyph_cache[256];
+
+static void set_transform (FT_Pos x, FT_Pos y) {
+	FT_Matrix matrix; /* transformation matrix */
+	FT_Vector pen;
 	matrix.xx = (FT_Fixed)(0x10000L);
 	matrix.xy = (FT_Fixed)(0x0L);
 	matrix.yx = (FT_Fixed)(0x0L);
 	matrix.yy = (FT_Fixed)(0x10000L);
+	pen.x = x;
+	pen.y = y;
+	FT_Set_Transform(face, &matrix, &pen);
+}
+
+static void glyph_from_slot (ST_Glyph *g) {
+	FT_GlyphSlot slot = face->glyph;
+	g->buffer    = slot->bitmap.buffer;
+	g->pitch     = slot->bitmap.width;
+	g->width     = slot->bitmap.width;
+	g->rows      = slot->bitmap.rows;
+	g->left      = slot->bitmap_left;
+	g->top       = slot->bitmap_top;
+	g->advance_x = slot->advance.x;
+	g->advance_y = slot->advance.y;
+}
+
+static void glyph_cache_clear (void) {
+	int i;
+	for (i = 0; i < 256; ++i) {
+		free (glyph_cache[i].buffer);
+	}
+	memset (glyph_cache, 0, sizeof (glyph_cache));
+}
+
+/* look up character `c` drawn at pen position `pen`,
+ * returns 0 on success */
+static int glyph_get (char c, const FT_Vector *pen, ST_Glyph *g) {
+	struct ST_CachedGlyph *cg = &glyph_cache[(unsigned char)c];
+
+	if ((pen->x & 63) || pen->y != ST_PEN_Y) {
+		set_transform (pen->x, pen->y);
+		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) return -1;
+		glyph_from_slot (g);
+		return 0;
+	}
+
+	if (cg->state == 0) {
+		ST_Glyph sg;
+		cg->state = -1;
+		set_transform (0, ST_PEN_Y);
+		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) return -1;
+		glyph_from_slot (&sg);
+		cg->buffer = malloc (MAX(1, sg.width * sg.rows));
+		if (!cg->buffer) return -1;
+		memcpy (cg->buffer, sg.buffer, sg.width * sg.rows);
+		cg->width     = sg.width;
+		cg->rows      = sg.rows;
+		cg->left      = sg.left;
+		cg->top       = sg.top;
+		cg->advance_x = sg.advance_x;
+		cg->advance_y = sg.advance_y;
+		cg->state = 1;
+	}
+	if (cg->state < 0) return -1;
+
+	g->buffer    = cg->buffer;
+	g->pitch     = cg->width;
+	g->width     = cg->width;
+	g->rows      = cg->rows;
+	/* freetype does not translate the position of empty bitmaps (space) */
+	g->left      = (cg->width > 0 && cg->rows > 0) ? cg->left + pen->x / 64 : cg->left;
+	g->top       = cg->top;
+	g->advance_x = cg->advance_x;
+	g->advance_y = cg->advance_y;
+	return 0;
+}
+
+/* Laid-out texts are kept on separate canvases. When a text changes
+ * only the glyphs from the first differing character on are cleared
+ * and drawn again, e.g. the last digits of a timecode.
+ */
+#define ST_SLOTS    (8)
+#define ST_MAXCHARS (256)
+
+struct ST_Layout {
+	FT_Vector pen;   // pen position of the glyph
+	int ok;          // glyph was drawn
+	int x0, x1;      // horizontal extent on the canvas
+	int top, rows;
+};
+
+struct ST_Slot {
+	unsigned char (*image)[ST_WIDTH];
+	char *text;
+	int dx;
+	int n;           // number of laid-out characters
+	int truncated;   // layout ended at the canvas' right edge, or has more than ST_MAXCHARS characters
+	int over;        // glyphs beyond ST_MAXCHARS that were drawn
+	int over_top, over_height; // ST_top, ST_height including those
+	int rightend;
+	FT_Vector pen;   // pen position after the last character
+	struct ST_Layout glyph[ST_MAXCHARS];
+	uint64_t stamp;
+};
+
+static struct ST_Slot *slots[ST_SLOTS];
+static uint64_t slot_stamp = 0;
+
+static void slots_clear (void) {
+	int i;
+	for (i = 0; i < ST_SLOTS; ++i) {
+		if (!slots[i]) continue;
+		free (slots[i]->text);
+		slots[i]->text = NULL;
+		slots[i]->n = 0;
+	}
+}
+
+static void slots_free (void) {
+	int i;
+	for (i = 0; i < ST_SLOTS; ++i) {
+		if (!slots[i]) continue;
+		free (slots[i]->text);
+		free (slots[i]->image);
+		free (slots[i]);
+		slots[i] = NULL;
+	}
+}
+
+static size_t common_prefix (const char *a, const char *b) {
+	size_t k = 0;
+	if (!a || !b) return 0;
+	while (a[k] && a[k] == b[k]) ++k;
+	return k;
+}
+
+/* pick the canvas that needs the least redrawing for `text` */
+static struct ST_Slot *slot_find (const char *text, int dx) {
+	struct ST_Slot *best = NULL;
+	size_t best_k = 0;
+	int i;
+
+	for (i = 0; i < ST_SLOTS; ++i) {
+		struct ST_Slot *s = slots[i];
+		size_t k;
+		if (!s || !s->text || s->dx != dx) continue;
+		k = common_prefix (s->text, text);
+		if (k > best_k || (k == best_k && best && k > 0 && s->stamp > best->stamp)) {
+			best = s;
+			best_k = k;
+		}
+	}
+	if (best) return best;
+
+	// unused or least recently used canvas
+	for (i = 0; i < ST_SLOTS; ++i) {
+		if (!slots[i]) {
+			slots[i] = calloc (1, sizeof (struct ST_Slot));
+			if (!slots[i]) break;
+			slots[i]->image = calloc (ST_HEIGHT, ST_WIDTH);
+			if (!slots[i]->image) {
+				free (slots[i]);
+				slots[i] = NULL;
+				break;
+			}
+			return slots[i];
+		}
+		if (!best || slots[i]->stamp < best->stamp) {
+			best = slots[i];
+		}
+	}
+	if (best) {
+		free (best->text);
+		best->text = NULL;
+		best->n = 0;
+	}
+	return best;
+}
+
+static void slot_draw_glyph (struct ST_Slot *s, const char *text, int n) {
+	const int target_height = ST_HEIGHT - 8;
+	ST_Glyph g;
+	if (!s->glyph[n].ok) return;
+	if (glyph_get (text[n], &s->glyph[n].pen, &g)) return;
+	draw_bitmap(s->image, &g, g.left, target_height - g.top);
+}
+
+/* vertical extent of the text, in the order the glyphs are drawn */
+static void extent_add (const struct ST_Layout *l, int *top, int *height) {
+	if (l->ok && l->rows > 0) {
+		const int bottom = l->top - l->rows;
+		if (l->top > *top) *top = l->top;
+		if (bottom < *top - *height) *height = *top - bottom;
+	}
+}
+
+static void slot_extent (const struct ST_Slot *s, int n, int *top, int *height) {
+	int i;
+	*top = *height = 0;
+	for (i = 0; i < n; ++i) {
+		extent_add (&s->glyph[i], top, height);
+	}
+}
+
+static void slot_layout (struct ST_Slot *s, const char *text, int dx) {
+	const int target_height = ST_HEIGHT - 8;
+	const int num_chars = strlen(text);
+	int n, k = 0;
+
+	if (s->text && s->dx == dx && !s->truncated) {
+		k = MIN(common_prefix (s->text, text), (size_t)s->n);
+		k = MIN(k, ST_MAXCHARS - 1);
+	}
+
+	if (k == 0) {
+		memset(&(s->image[0][0]),0,ST_WIDTH*ST_HEIGHT);
+		s->pen.x = ST_PEN_X;
+		s->pen.y = ST_PEN_Y;
+		s->rightend = 0;
+		s->over = 0;
+	} else {
+		/* clear what was drawn from the first changed glyph on,
+		 * and re-draw preceding glyphs which overlap the area */
+		int x0 = ST_WIDTH, x1 = 0, y;
+		for (n = k; n < s->n; ++n) {
+			if (!s->glyph[n].ok) continue;
+			x0 = MIN(x0, s->glyph[n].x0);
+			x1 = MAX(x1, s->glyph[n].x1);
+		}
+		x0 = MAX(0, x0);
+		x1 = MIN(ST_WIDTH, x1);
+		if (x1 > x0) {
+			for (y = 0; y < ST_HEIGHT; ++y) {
+				memset(&s->image[y][x0], 0, x1 - x0);
+			}
+			for (n = 0; n < k; ++n) {
+				if (s->glyph[n].ok && s->glyph[n].x1 > x0) {
+					slot_draw_glyph (s, text, n);
+				}
+			}
+		}
+		/* when the text is only extended, s->pen is already the pen
+		 * after the last glyph; glyph[k] is not laid out for it */
+		if (k < s->n) {
+			s->pen = s->glyph[k].pen;
+		}
+		s->rightend = s->pen.x / 64;
+	}
+
+	s->truncated = 0;
+	for (n = k; n < num_chars; n++)
+	{
+		/* characters past ST_MAXCHARS are drawn, but not kept for re-use */
+		struct ST_Layout over;
+		struct ST_Layout *l = n < ST_MAXCHARS ? &s->glyph[n] : &over;
+		ST_Glyph g;
+
+		l->pen = s->pen;
+		l->ok  = 0;
+
+		/* load glyph image */
+		if (glyph_get (text[n], &s->pen, &g)) continue;  /* ignore errors */
+
+		/* now, draw to our target surface (convert position) */
+		draw_bitmap(s->image, &g, g.left, target_height - g.top);
+		l->ok   = 1;
+		l->x0   = g.left;
+		l->x1   = g.left + g.width;
+		l->top  = g.top;
+		l->rows = g.rows;
+		if (l == &over && g.rows > 0) {
+			if (s->over++ == 0) {
+				slot_extent (s, ST_MAXCHARS, &s->over_top, &s->over_height);
+			}
+			extent_add (l, &s->over_top, &s->over_height);
+		}
+
+		if ((g.left + g.width) > ST_WIDTH) {
+			s->truncated = 1;
+			++n;
+			break;
+		}
+
+		/* increment pen position */
+		s->pen.x += dx > 0 ? dx *64 : g.advance_x;
+		s->pen.y += g.advance_y;
+
+		s->rightend = s->pen.x / 64;
+	}
+	if (n > ST_MAXCHARS) {
+		s->truncated = 1;
+		n = ST_MAXCHARS;
+	}
+	s->n = n;
+	s->dx = dx;
+	free (s->text);
+	s->text = strdup (text);
+}
+
+int render_font (char *fontfile, char *text, int px, int dx)
+{
+	static int pxx = 0;
+	FT_Error      error;
+	struct ST_Slot *s;
 
 	if (!ff || strcmp(fontfile, ff) || pxx != px || !initialized) {
 #ifndef WITH_EMBEDDED_FONT
@@ -117,6 +444,8 @@ int render_font (char *fontfile, char *text, int px, int dx)
 		pxx = px;
 		free(ff);
 		ff = strdup(fontfile);
+		glyph_cache_clear ();
+		slots_clear ();
 		if (initialized) {
 			FT_Done_Face    (face);
 			FT_Done_FreeType(library);
@@ -151,50 +480,22 @@ int render_font (char *fontfile, char *text, int px, int dx)
 		initialized = 1;
 	}
 
-	/* the pen position incartesian space coordinates; */
-	pen.x = 1  * 64;
-	pen.y = 10 * 64;
-
-	num_chars     = strlen(text);
-	target_height = ST_HEIGHT - 8;
-	slot = face->glyph;
-
-	memset(&(ST_image[0][0]),0,ST_WIDTH*ST_HEIGHT);
-	ST_rightend=0;
-	ST_height = 0;
-	ST_top = 0;
+	s = slot_find (text, dx);
+	if (!s) return -1;
+	s->stamp = ++slot_stamp;
 
-	for (n = 0; n < num_chars; n++)
-	{
-		/* set transformation */
-		FT_Set_Transform(face, &matrix, &pen);
-
-		/* load glyph image into the slot (erase previous one) */
-		error = FT_Load_Char(face, text[n], FT_LOAD_RENDER);
-		if (error) continue;  /* ignore errors */
-
-		/* now, draw to our target surface (convert position) */
-		draw_bitmap(&slot->bitmap,
-				slot->bitmap_left,
-				target_height - slot->bitmap_top);
-
-		if (slot->bitmap.rows > 0) {
-			const int bottom = slot->bitmap_top - slot->bitmap.rows;
-			if (slot->bitmap_top > ST_top) ST_top = slot->bitmap_top;
-			if (bottom < ST_top - ST_height) ST_height = ST_top - bottom;
-		}
-
-		if ((slot->bitmap_left + slot->bitmap.width) > ST_WIDTH)
-			break;
-
-		/* increment pen position */
-		pen.x += dx > 0 ? dx *64 : slot->advance.x;
-		pen.y += slot->advance.y;
-
-		ST_rightend=pen.x/64;
+	if (!s->text || s->dx != dx || strcmp (s->text, text)) {
+		slot_layout (s, text, dx);
 	}
 
-	ST_rightend+=1;
+	ST_image = s->image;
+	ST_rightend = s->rightend + 1;
+	if (s->over > 0) {
+		ST_top = s->over_top;
+		ST_height = s->over_height;
+	} else {
+		slot_extent (s, s->n, &ST_top, &ST_height);
+	}
 
 	return 0;
 }
@@ -202,6 +503,9 @@ int render_font (char *fontfile, char *text, int px, int dx)
 void free_freetype () {
 	free(ff);
 	ff = NULL;
+	glyph_cache_clear ();
+	slots_free ();
+	ST_image = NULL;
 	if (initialized) {
 		FT_Done_Face    (face);
 		FT_Done_FreeType(library);
@@ -211,7 +515,7 @@ void free_freetype () {
 
 #else  /* No freetype */
 
-unsigned char ST_image[1][1];
+unsigned char (*ST_image)[ST_WIDTH] = NULL;
 int ST_rightend = 0;
 int ST_height = 0;
 int ST_top = 0;
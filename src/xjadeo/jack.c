@@ -25,15 +25,67 @@
 #include "weak_libjack.h"
 
 #include "xjadeo.h"
+#include "gtime.h"
 
 extern double framerate;
 extern int want_quiet;
 extern int jack_clkconvert;
 extern int interaction_override;
 extern int jack_autostart;
+extern int want_jacksnapshot;
 
 static jack_client_t *jack_client = NULL;
 
+/* transport position snapshot, written by the process callback
+ * once per cycle (--jack-snapshot). The event loop interpolates
+ * from it instead of querying jack itself.
+ *
+ * Same sequence lock as in ltc-jack.c: jt_seq is odd while the
+ * writer modifies jt_pub, readers retry until they get a clean copy.
+ */
+typedef struct {
+	int     valid;
+	jack_transport_state_t state;
+	jack_position_t pos;
+	int64_t usec;    ///< xj_get_monotonic_time() at the start of the cycle
+	int64_t limit;   ///< [us] max time to interpolate past usec
+} JackSnapshot;
+
+static volatile unsigned int jt_seq = 0;
+static JackSnapshot jt_pub;
+static int jt_active = 0;
+static jack_nframes_t jt_samplerate = 48000;
+
+/* arg is the client: jack_client is cleared by close_jack() before
+ * the client is deactivated, while this callback may still run.
+ */
+static int jack_process (jack_nframes_t nframes, void *arg) {
+	jack_client_t *client = (jack_client_t *)arg;
+	JackSnapshot js;
+	const int64_t now = xj_get_monotonic_time ();
+	js.valid = 1;
+	js.state = WJACK_transport_query (client, &js.pos);
+	js.usec  = now - (int64_t) WJACK_frames_since_cycle_start (client) * 1000000 / jt_samplerate;
+	js.limit = 2 * (int64_t)nframes * 1000000 / jt_samplerate;
+
+	++jt_seq;
+	__sync_synchronize ();
+	jt_pub = js;
+	__sync_synchronize ();
+	++jt_seq;
+	return 0;
+}
+
+static void jack_snapshot (JackSnapshot *js) {
+	unsigned int seq;
+	do {
+		seq = jt_seq;
+		__sync_synchronize ();
+		*js = jt_pub;
+		__sync_synchronize ();
+	} while ((seq & 1) || seq != jt_seq);
+}
+
 /* when jack shuts down... */
 static void jack_shutdown(void *arg) {
 	jack_client=NULL;
@@ -56,6 +108,19 @@ void open_jack(void ) {
 		return;
 	}
 	WJACK_on_shutdown (jack_client, jack_shutdown, 0);
+
+	jt_active = 0;
+	jt_pub.valid = 0;
+	if (want_jacksnapshot) {
+		jt_samplerate = WJACK_get_sample_rate (jack_client);
+		WJACK_set_process_callback (jack_client, jack_process, jack_client);
+		if (WJACK_activate (jack_client)) {
+			if (!want_quiet)
+				fprintf (stderr, "cannot activate jack client, querying transport from the GUI thread.\n");
+		} else {
+			jt_active = 1;
+		}
+	}
 }
 
 void jackt_rewind() {
@@ -103,11 +168,32 @@ void close_jack(void) {
 
 int64_t jack_poll_frame (uint8_t *rolling) {
 	jack_position_t	jack_position;
+	jack_transport_state_t jts;
 	int64_t frame = 0;
 
 	if (!jack_client) return (-1);
-	memset(&jack_position, 0, sizeof(jack_position));
-	jack_transport_state_t jts = WJACK_transport_query(jack_client, &jack_position);
+
+	JackSnapshot js;
+	if (jt_active) {
+		jack_snapshot (&js);
+	} else {
+		js.valid = 0;
+	}
+
+	if (js.valid) {
+		jts = js.state;
+		jack_position = js.pos;
+		if (jts == JackTransportRolling) {
+			/* interpolate the position to now, at most two cycles ahead */
+			int64_t elapsed = xj_get_monotonic_time () - js.usec;
+			if (elapsed < 0) elapsed = 0;
+			if (elapsed > js.limit) elapsed = js.limit;
+			jack_position.frame += (jack_nframes_t) (elapsed * jack_position.frame_rate / 1000000);
+		}
+	} else {
+		memset(&jack_position, 0, sizeof(jack_position));
+		jts = WJACK_transport_query(jack_client, &jack_position);
+	}
 
 #ifdef JACK_DEBUG
 	fprintf(stdout, "jack position: %u %u/ \n", (unsigned int) jack_position.frame, (unsigned int) jack_position.frame_rate);
@@ -26,8 +26,10 @@
 #include <stdio.h>
 #include <ltc.h>
 #include <math.h>
+#include <string.h>
 
 #include "xjadeo.h"
+#include "gtime.h"
 #include "weak_libjack.h"
 
 extern int want_quiet;
@@ -41,11 +43,33 @@ static jack_default_audio_sample_t *j_in;
 static jack_nframes_t j_latency = 0;
 static jack_client_t *j_client = NULL;
 
-static double ltc_position = 0;
 static uint64_t monotonic_fcnt = 0;
 static LTCDecoder *ltc_decoder = NULL;
 
-static int myProcess(LTCDecoder *d, double *jt)  {
+/* LTC position, published by the jack process thread once per cycle
+ * and read by the main event loop.
+ *
+ * The writer increments ltc_seq to an odd value before and back to
+ * an even value after modifying ltc_pub. The reader retries until it
+ * sees the same even value before and after copying the struct.
+ */
+typedef struct {
+	int     valid;   ///< an LTC frame has been decoded
+	double  pos;     ///< LTC position [samples] at sample 'anchor'
+	int64_t anchor;  ///< monotonic sample count of the end of the last LTC frame
+	double  speed;   ///< LTC samples per audio sample (negative: reverse)
+	int64_t fcnt;    ///< monotonic sample count at the start of the cycle
+	int64_t usec;    ///< xj_get_monotonic_time() at the start of the cycle
+	int64_t limit;   ///< max samples to extrapolate past 'anchor'
+	uint64_t decoded; ///< number of decoded LTC frames
+	uint64_t dropped; ///< number of LTC frames missing between decoded ones
+} LTCPosition;
+
+static volatile unsigned int ltc_seq = 0;
+static LTCPosition ltc_pub;
+static LTCPosition ltc_rt; // process thread's private copy
+
+static int myProcess(LTCDecoder *d, LTCPosition *lp)  {
 	LTCFrameExt frame;
 	int rv=0;
 	while (ltc_decoder_read(d,&frame)) {
@@ -65,18 +89,59 @@ static int myProcess(LTCDecoder *d, double *jt)  {
 				);
 #endif
 
-		if (jt) {
-			*jt = (double) (
+		if (lp) {
+			const double spf = j_samplerate / framerate;
+			/* timecode refers to the start of the frame,
+			 * when playing forward its end was reached at off_end */
+			const double pos = (double) (
 					((stime.hours*60+stime.mins)*60 +stime.secs) * j_samplerate
 					+ ((double)stime.frame*(double)j_samplerate / framerate)
-					+ frame.off_end - monotonic_fcnt
+					+ (frame.reverse ? 0 : spf)
 					);
+			const ltc_off_t flen = frame.off_end - frame.off_start;
+			double speed = frame.reverse ? -1 : 1;
+			if (lp->valid && frame.off_end > lp->anchor
+					&& fabs (fabs (pos - lp->pos) - spf) < .5 * spf) {
+				/* consecutive frames, measure the actual speed */
+				speed = (pos - lp->pos) / (double)(frame.off_end - lp->anchor);
+				if (speed > 4) speed = 4;
+				if (speed < -4) speed = -4;
+			} else if (lp->valid && flen > 0 && frame.off_end - lp->anchor > flen + flen / 2
+					&& frame.off_end - lp->anchor < j_samplerate) {
+				/* short gap in the decoded stream, longer ones are not
+				 * counted: the LTC signal itself was interrupted */
+				lp->dropped += (frame.off_end - lp->anchor + flen / 2) / flen - 1;
+			}
+			++lp->decoded;
+			lp->valid  = 1;
+			lp->pos    = pos;
+			lp->speed  = speed;
+			lp->anchor = frame.off_end;
+			lp->limit  = 2 * flen;
 		}
 		++rv;
 	}
 	return rv;
 }
 
+static void publish_position (const LTCPosition *lp) {
+	++ltc_seq;
+	__sync_synchronize ();
+	ltc_pub = *lp;
+	__sync_synchronize ();
+	++ltc_seq;
+}
+
+static void read_position (LTCPosition *lp) {
+	unsigned int seq;
+	do {
+		seq = ltc_seq;
+		__sync_synchronize ();
+		*lp = ltc_pub;
+		__sync_synchronize ();
+	} while ((seq & 1) || seq != ltc_seq);
+}
+
 #ifdef NEW_JACK_LATENCY_API
 static int jack_latency_cb(void *arg) {
 	jack_latency_range_t jlty;
@@ -86,26 +151,46 @@ static int jack_latency_cb(void *arg) {
 }
 #endif
 
+/* samples per ltc_decoder_write() call. This is less than the
+ * duration of a LTC frame, so the decoder's queue never overflows
+ * regardless of the JACK period size. */
+#define LTC_CHUNK 1024
+
 /**
  * jack audio process callback
  */
 static int process (jack_nframes_t nframes, void *arg) {
-	unsigned char sound[8192];
-	size_t i;
+	ltcsnd_sample_t sound[LTC_CHUNK];
+	jack_nframes_t off;
+	const int64_t now = xj_get_monotonic_time ();
 	j_in = WJACK_port_get_buffer (j_input_port, nframes);
 
 #ifndef NEW_JACK_LATENCY_API
 	j_latency = WJACK_port_get_total_latency(j_client,j_input_port);
 #endif
-	if (nframes > 8192) return 0;
 
-	for (i = 0; i < nframes; i++) {
-	  const int snd=(int)rint((127.0*j_in[i])+128.0);
-	  sound[i] = (unsigned char) (snd&0xff);
+	for (off = 0; off < nframes; off += LTC_CHUNK) {
+		const jack_nframes_t n = (nframes - off) < LTC_CHUNK ? (nframes - off) : LTC_CHUNK;
+		const float *in = &j_in[off];
+		jack_nframes_t i;
+		/* plain loop, no libm calls; the compiler can vectorize it */
+		for (i = 0; i < n; ++i) {
+			float snd = 127.f * in[i] + 128.5f;
+			if (snd < 0.f) snd = 0.f;
+			if (snd > 255.f) snd = 255.f;
+			sound[i] = (ltcsnd_sample_t) snd;
+		}
+		ltc_decoder_write(ltc_decoder, sound, n, monotonic_fcnt + off - j_latency);
+		myProcess(ltc_decoder, &ltc_rt);
 	}
 
-	ltc_decoder_write(ltc_decoder, sound, nframes, monotonic_fcnt - j_latency);
-	myProcess(ltc_decoder, &ltc_position);
+	/* with the capture latency subtracted, the decoder's sample
+	 * at monotonic_fcnt is the one at the start of this cycle */
+	ltc_rt.fcnt = monotonic_fcnt;
+	ltc_rt.usec = now;
+	if (ltc_rt.limit < 2 * (int64_t)nframes) ltc_rt.limit = 2 * nframes;
+	publish_position (&ltc_rt);
+
 	monotonic_fcnt += nframes;
 	return 0;
 }
@@ -140,11 +225,30 @@ static int jack_portsetup(void) {
 
 /* API */
 
+void ltc_stats (uint64_t *decoded, uint64_t *dropped) {
+	LTCPosition lp;
+	read_position (&lp);
+	*decoded = lp.decoded;
+	*dropped = lp.dropped;
+}
+
 int64_t ltc_poll_frame (void) {
-	return (int64_t) rint(ltc_position * framerate / (double)j_samplerate);
+	LTCPosition lp;
+	read_position (&lp);
+	if (!lp.valid) return 0;
+
+	/* extrapolate to now, but not past the point where the
+	 * next LTC frame should have been decoded */
+	int64_t now = lp.fcnt + (xj_get_monotonic_time () - lp.usec) * j_samplerate / 1000000;
+	int64_t age = now - lp.anchor;
+	if (age < 0) age = 0;
+	if (age > lp.limit) age = lp.limit;
+	return (int64_t) floor((lp.pos + age * lp.speed) * framerate / (double)j_samplerate);
 }
 
 void open_ltcjack(char *autoconnect) {
+	memset (&ltc_rt, 0, sizeof (LTCPosition));
+	publish_position (&ltc_rt);
 
 	if (xj_init_jack (&j_client, "xjadeo")) {
 		return;
@@ -187,6 +291,7 @@ void close_ltcjack(void) {
 #include <stdint.h>
 
 int64_t ltc_poll_frame (void) { return 0;}
+void ltc_stats (uint64_t *decoded, uint64_t *dropped) { *decoded = *dropped = 0; }
 void open_ltcjack(char *autoconnect) { ; }
 void close_ltcjack(void) { ; }
 int ltcjack_connected(void) { return 0;}
@@ -39,6 +39,11 @@ void osx_main ();
 void osx_shutdown();
 #endif
 
+#if (defined HAVE_GL && !defined PLATFORM_WINDOWS && !defined PLATFORM_OSX) || HAVE_LIBXV || HAVE_IMLIB2
+#define XJ_XLIB
+#include <X11/Xlib.h>
+#endif
+
 // configuration strings
 char const * const cfg_features = ""
 #define CFG_STRING ""
@@ -170,9 +175,17 @@ int want_genpts =0;	/* --genpts */
 int want_ignstart =0;	/* --ignorefileoffset */
 int want_nosplash =0;	/* --nosplash */
 int want_noindex =0;	/* --noindex */
+int want_idxcache =1;	/* --no-index-cache */
+int want_idxinline =1;	/* --no-index-inline */
 int start_ontop =0;	/* --ontop // -a */
 int start_fullscreen =0;/* --fullscreen // -s */
 int want_letterbox =1;  /* --letterbox -b */
+int want_glyuv =1;      /* --no-gl-yuv */
+int want_glthread =1;   /* --no-gl-thread */
+int want_prescale =0;   /* --prescale */
+int want_syncsmooth =0; /* --sync-smooth <int> bitmask 1:jack 2:MTC 4:LTC */
+double syncsmooth_bw = 0.25; /* bandwidth of the sync smoothing loop [Hz] */
+int want_jacksnapshot =0; /* --jack-snapshot */
 int want_dropframes =0; /* --dropframes -N  -- force using drop-frame timecode */
 int want_autodrop =1;   /* --nodropframes -n (hidden option) -- allow using drop-frame timecode */
 int remote_en =0;	/* --remote, -R */
@@ -217,6 +230,11 @@ int    midi_clkadj =1;	/* --midiclk  */
 int    videomode = 0; // --vo <int>  - default: autodetect
 double delay = -1; // use file's FPS
 int keyframe_interval_limit = 100;
+int frame_cache_mb = 128; // --frame-cache <MB>
+int readahead_frames = 8; // --read-ahead <int>
+int decoder_threads = 0; // --decoder-threads <int>, 0: auto
+int index_threads = 0; // --index-threads <int>, 0: auto
+int scale_threads = 0; // --scale-threads <int>, 0: auto
 
 
 // On screen display
@@ -290,6 +308,18 @@ static struct option const long_options[] =
 
 	{"osc-doc",             no_argument, 0,       0x100},
 	{"no-index",            no_argument, 0,       0x101},
+	{"frame-cache",         required_argument, 0, 0x102},
+	{"read-ahead",          required_argument, 0, 0x103},
+	{"decoder-threads",     required_argument, 0, 0x104},
+	{"no-index-cache",      no_argument, 0,       0x105},
+	{"index-threads",       required_argument, 0, 0x106},
+	{"no-index-inline",     no_argument, 0,       0x107},
+	{"no-gl-yuv",           no_argument, 0,       0x108},
+	{"scale-threads",       required_argument, 0, 0x109},
+	{"prescale",            no_argument, 0,       0x10a},
+	{"sync-smooth",         required_argument, 0, 0x10b},
+	{"jack-snapshot",       no_argument, 0,       0x10c},
+	{"no-gl-thread",        no_argument, 0,       0x10d},
 	{NULL, 0, NULL, 0}
 };
 
@@ -493,6 +523,47 @@ decode_switches (int argc, char **argv)
 			case 0x101:
 				want_noindex = 1;
 				break;
+			case 0x102:
+				frame_cache_mb = atoi(optarg);
+				if (frame_cache_mb < 0) frame_cache_mb = 0;
+				break;
+			case 0x103:
+				readahead_frames = atoi(optarg);
+				if (readahead_frames < 0) readahead_frames = 0;
+				break;
+			case 0x104:
+				decoder_threads = atoi(optarg);
+				if (decoder_threads < 0) decoder_threads = 0;
+				break;
+			case 0x105:
+				want_idxcache = 0;
+				break;
+			case 0x106:
+				index_threads = atoi(optarg);
+				if (index_threads < 0) index_threads = 0;
+				break;
+			case 0x107:
+				want_idxinline = 0;
+				break;
+			case 0x108:
+				want_glyuv = 0;
+				break;
+			case 0x109:
+				scale_threads = atoi(optarg);
+				if (scale_threads < 0) scale_threads = 0;
+				break;
+			case 0x10a:
+				want_prescale = 1;
+				break;
+			case 0x10b:
+				want_syncsmooth = atoi(optarg);
+				break;
+			case 0x10c:
+				want_jacksnapshot = 1;
+				break;
+			case 0x10d:
+				want_glthread = 0;
+				break;
 			default:
 				usage (EXIT_FAILURE);
 				break;
@@ -524,6 +595,8 @@ usage (int status)
 " -c, --no-midiclk          Ignore MTC quarter frames.\n"
 #endif
 " -D, --debug               Print development related information.\n"
+" --decoder-threads <int>   Number of threads used by the video decoder.\n"
+"                           0: autodetect (default), 1: single-threaded.\n"
 " -d <name>, --midi-driver <name>\n"
 "                           Specify midi driver to use. Run 'xjadeo -V' to\n"
 "                           list supported driver(s). <name> is case insensitive\n"
@@ -537,6 +610,46 @@ usage (int status)
 "                           Note: This does not affect screen/vblank sync.\n"
 "                           Synchronizing to the screen's vertical refresh is\n"
 "                           hardware dependent (and always used if available).\n"
+" --frame-cache <MB>        Memory limit for recently decoded frames (default\n"
+"                           128). Cached frames are displayed again without\n"
+"                           seeking and decoding. 0 disables the cache.\n"
+" --read-ahead <int>        Number of frames to decode ahead in a background\n"
+"                           thread, following the direction and speed of the\n"
+"                           sync source (default 8, 0: disable). Decoded frames\n"
+"                           are kept in the frame-cache, which is enlarged to\n"
+"                           hold at least 2 * <int> + 2 frames if needed.\n"
+" --no-index-cache          Do not load or save the frame-index of video files\n"
+"                           from/to the cache directory ($XDG_CACHE_HOME/xjadeo/).\n"
+"                           Per default the index is re-used when the same,\n"
+"                           unmodified file is opened again.\n"
+" --no-index-inline         Verify keyframes by seeking to each of them, instead\n"
+"                           of decoding them while reading the file. This is\n"
+"                           slower, but may help with broken files.\n"
+" --no-gl-yuv               Convert frames to RGB on the CPU for the openGL\n"
+"                           display. Per default the YUV planes are uploaded\n"
+"                           as-is and converted by the graphics card.\n"
+" --no-gl-thread            Draw and swap openGL frames in the main loop instead\n"
+"                           of a separate presenter thread (X11 only). Use with\n"
+"                           the remote command 'get pacing' to compare frame\n"
+"                           pacing.\n"
+" --scale-threads <int>     Number of threads used to convert decoded frames to\n"
+"                           the display's pixel format. Each thread converts a\n"
+"                           horizontal slice of the frame.\n"
+"                           0: autodetect (default), 1: single-threaded.\n"
+" --prescale                Scale frames to the size of the window before they\n"
+"                           are handed to the display. This reduces conversion\n"
+"                           and upload cost for small windows, the buffers are\n"
+"                           re-allocated when the window is resized.\n"
+" --sync-smooth <int>       Interpolate the sync position between updates of\n"
+"                           the sync source. This avoids jumpy playback when\n"
+"                           the source reports its position in bursts, e.g.\n"
+"                           JACK with large buffer sizes.\n"
+"                           Bitmask of sync sources to smooth:\n"
+"                           1: jack, 2: MTC, 4: LTC (default: 0, off).\n"
+" --jack-snapshot           Read the JACK transport position in the JACK process\n"
+"                           callback once per cycle and interpolate it to the\n"
+"                           time of display, instead of querying JACK from the\n"
+"                           event loop.\n"
 /*-------------------------------------------------------------------------------|" */
 " -h, --help                Display this help and exit.\n"
 " -I, --ignore-file-offset\n"
@@ -546,6 +659,8 @@ usage (int status)
 "                           video file header. This option allows one to\n"
 "                           override (and subtract) this offset to align the\n"
 "                           start of the file with timecode 00:00:00:00.\n"
+" --index-threads <int>     Number of threads used to verify keyframes while\n"
+"                           indexing a file. 0: one per CPU core (default).\n"
 " -i <int>, --info <int>    Display time information using the OSD (on screen \n"
 "                           display).\n"
 "                           0:Off, %d: Frame number, %d: Timecode, %d: both.\n"
@@ -814,6 +929,7 @@ static void clean_up (int status) {
 	close_window();
 
 	close_movie();
+	sws_cache_free();
 
 #ifdef HAVE_MIDI
 	if (midi_driver) free(midi_driver);
@@ -1020,6 +1136,12 @@ int main (int argc, char **argv)
 
 	i = decode_switches (argc, argv);
 
+#ifdef XJ_XLIB
+	// must precede any other Xlib call: the GLX presenter thread
+	// shares the display connection with the event loop.
+	XInitThreads();
+#endif
+
 	if (init_weak_jack()) {
 		if (!want_quiet)
 			fprintf(stderr, "Failed load JACK shared library.\n");
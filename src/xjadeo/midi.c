@@ -450,29 +450,21 @@ static int64_t pm_midi_poll_frame (void) {
 static jack_client_t *jack_midi_client = NULL;
 static jack_port_t   *jack_midi_port;
 
-#define JACK_MIDI_QUEUE_SIZE (1024)
-typedef struct my_midi_event {
-	jack_nframes_t time;
-	size_t size;
-	jack_midi_data_t buffer[16];
-} my_midi_event_t;
-
-static my_midi_event_t event_queue[JACK_MIDI_QUEUE_SIZE];
-static int queued_events_start = 0;
-static int queued_events_end = 0;
-static int queued_cycle_id = 0;
+#include "midi_queue.h"
+
+static jm_queue_t jm_queue;
 
 static void dequeue_jmidi_events(jack_nframes_t until) {
-	int ci = queued_cycle_id;
-	int new=0; // always process data from prev. jack cycles.
-	while (queued_events_start != queued_events_end) {
-		if (queued_events_start == ci ) new=1;
-		if (new && event_queue[queued_events_start].time > until) {
+	unsigned int rd, ci;
+	const unsigned int end = jmq_peek (&jm_queue, &rd, &ci);
+
+	while (rd != end) {
+		my_midi_event_t *ev = jmq_event (&jm_queue, rd);
+		// always process data from prev. jack cycles.
+		if ((int)(rd - ci) >= 0 && ev->time > until) {
 			break;
 		}
 
-		my_midi_event_t *ev = &event_queue[queued_events_start];
-
 		if (ev->size==2 && ev->buffer[0] == 0xf1) {
 			parse_timecode(ev->buffer[1]);
 		} else if (ev->size >9 && ev->buffer[0] == 0xf0) {
@@ -482,15 +474,17 @@ static void dequeue_jmidi_events(jack_nframes_t until) {
 				sysex_type = parse_sysex_urtm(ev->buffer[i],i-1,sysex_type);
 			}
 		}
-		queued_events_start = (queued_events_start +1 ) % JACK_MIDI_QUEUE_SIZE;
+		++rd;
 	}
+	jmq_release (&jm_queue, rd);
 }
 
 static int jack_midi_process(jack_nframes_t nframes, void *arg) {
 	void *jack_buf = WJACK_port_get_buffer(jack_midi_port, nframes);
 	int nevents = WJACK_midi_get_event_count(jack_buf);
 	int n;
-	queued_cycle_id = queued_events_end;
+
+	jmq_cycle (&jm_queue);
 
 	for (n=0; n<nevents; n++) {
 		jack_midi_event_t ev;
@@ -498,12 +492,8 @@ static int jack_midi_process(jack_nframes_t nframes, void *arg) {
 
 		if (ev.size <1 || ev.size > 15) {
 			continue;
-		} else {
-			event_queue[queued_events_end].time = ev.time;
-			event_queue[queued_events_end].size = ev.size;
-			memcpy (event_queue[queued_events_end].buffer, ev.buffer, ev.size);
-			queued_events_end = (queued_events_end +1 ) % JACK_MIDI_QUEUE_SIZE;
 		}
+		jmq_push (&jm_queue, ev.time, ev.buffer, ev.size);
 	}
 	return 0;
 }
@@ -579,8 +569,15 @@ static int64_t jm_midi_poll_frame (void) {
 	int64_t frame =0 ;
 	static int64_t lastframe = -1 ;
 	static int stopcnt = 0;
+	static unsigned int overflow = 0;
 
 	dequeue_jmidi_events(WJACK_frames_since_cycle_start(jack_midi_client));
+	const unsigned int dropped = jmq_overflow (&jm_queue);
+	if (overflow != dropped) {
+		if (!want_quiet)
+			fprintf(stderr, "jack-midi: MTC queue overflow, %u events dropped.\n", dropped - overflow);
+		overflow = dropped;
+	}
 	frame = convert_smpte_to_frame(last_tc);
 
 	if(midi_clkadj && (full_tc==0xff)) {
@@ -0,0 +1,88 @@
+/* xjadeo - jack-midi event queue
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/* included by midi.c and by contrib/midiqueue */
+
+#include <stdint.h>
+#include <string.h>
+
+/* single-producer, single-consumer ring buffer.
+ * The jack process callback is the only writer of `write`, `cycle`
+ * and `overflow`, the consumer the only writer of `read`.
+ * Both indices run freely and are masked on access; the queue is
+ * full when they are JACK_MIDI_QUEUE_SIZE apart.
+ */
+#define JACK_MIDI_QUEUE_SIZE (1024) // must be a power of two
+
+typedef struct my_midi_event {
+	uint32_t time;
+	size_t size;
+	uint8_t buffer[16];
+} my_midi_event_t;
+
+typedef struct {
+	my_midi_event_t event[JACK_MIDI_QUEUE_SIZE];
+	unsigned int read;
+	unsigned int write;
+	unsigned int cycle;    ///< `write` at the start of the current cycle
+	unsigned int overflow; ///< number of dropped events
+} jm_queue_t;
+
+/* producer: start of a process cycle */
+static void jmq_cycle (jm_queue_t *q) {
+	// published along with the next event by the release in jmq_push()
+	__atomic_store_n (&q->cycle, q->write, __ATOMIC_RELAXED);
+}
+
+/* producer: append an event, returns -1 if the queue is full */
+static int jmq_push (jm_queue_t *q, uint32_t time, const uint8_t *data, size_t size) {
+	const unsigned int wr = q->write;
+	// the consumer is done with a slot once it released it
+	if (wr - __atomic_load_n (&q->read, __ATOMIC_ACQUIRE) >= JACK_MIDI_QUEUE_SIZE) {
+		__atomic_store_n (&q->overflow, q->overflow + 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+	my_midi_event_t *e = &q->event[wr & (JACK_MIDI_QUEUE_SIZE - 1)];
+	e->time = time;
+	e->size = size;
+	memcpy (e->buffer, data, size);
+	__atomic_store_n (&q->write, wr + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* consumer: events [*rd, end) are readable, those before `*cycle`
+ * were queued in a previous process cycle. Returns `end`.
+ */
+static unsigned int jmq_peek (jm_queue_t *q, unsigned int *rd, unsigned int *cycle) {
+	const unsigned int end = __atomic_load_n (&q->write, __ATOMIC_ACQUIRE);
+	*cycle = __atomic_load_n (&q->cycle, __ATOMIC_RELAXED);
+	*rd = q->read;
+	return end;
+}
+
+static my_midi_event_t *jmq_event (jm_queue_t *q, unsigned int i) {
+	return &q->event[i & (JACK_MIDI_QUEUE_SIZE - 1)];
+}
+
+/* consumer: hand events before `rd` back to the producer */
+static void jmq_release (jm_queue_t *q, unsigned int rd) {
+	__atomic_store_n (&q->read, rd, __ATOMIC_RELEASE);
+}
+
+static unsigned int jmq_overflow (jm_queue_t *q) {
+	return __atomic_load_n (&q->overflow, __ATOMIC_RELAXED);
+}
@@ -112,6 +112,8 @@ extern int     wraparound;
 
 extern double delay;
 extern int    videomode;
+extern int    want_syncsmooth;
+extern double syncsmooth_bw;
 extern int    interaction_override;
 
 // On screen display
@@ -199,11 +201,9 @@ void xapi_set_videomode(void *d) {
 		char *fn=strdup(current_file);
 		open_movie(fn);
 		free(fn);
-	} else {
-		if(buffer) free(buffer); buffer=NULL;
-		// set videomode to 0 or loop_flag=0?
 	}
-	init_moviebuffer();
+	// set videomode to 0 or loop_flag=0 if there's no file?
+	init_moviebuffer(); // (re)allocates the buffer
 	force_redraw=1;
 }
 
@@ -425,6 +425,69 @@ void xapi_pmheight(void *d) {
 	remote_printf(201,"movie_height=%i", movie_height);
 }
 
+void xapi_pframecache(void *d) {
+	uint64_t hits, misses;
+	int used, size;
+	frame_cache_stats (&hits, &misses, &used, &size);
+	remote_printf(201,"cachehits=%"PRIu64, hits);
+	remote_printf(201,"cachemisses=%"PRIu64, misses);
+	remote_printf(201,"cacheframes=%i", used);
+	remote_printf(201,"cachesize=%i", size);
+}
+
+void xapi_predraws(void *d) {
+	uint64_t recomposited, skipped;
+	redraw_stats (&recomposited, &skipped);
+	remote_printf(201,"redrawsosdonly=%"PRIu64, recomposited);
+	remote_printf(201,"redrawsskipped=%"PRIu64, skipped);
+}
+
+void xapi_ppacing(void *d) {
+	uint64_t presented, skipped;
+	double interval, jitter;
+	pacing_stats (&presented, &skipped, &interval, &jitter);
+	remote_printf(201,"pacingpresented=%"PRIu64, presented);
+	remote_printf(201,"pacingskipped=%"PRIu64, skipped);
+	remote_printf(201,"pacinginterval=%.3f", interval);
+	remote_printf(201,"pacingjitter=%.3f", jitter);
+}
+
+void xapi_pconversion(void *d) {
+	uint64_t frames;
+	int64_t last, avg, peak;
+	int slices;
+	conversion_stats (&frames, &last, &avg, &peak, &slices);
+	remote_printf(201,"convslices=%i", slices);
+	remote_printf(201,"convframes=%"PRIu64, frames);
+	remote_printf(201,"convlast=%"PRId64, last);
+	remote_printf(201,"convavg=%"PRId64, avg);
+	remote_printf(201,"convpeak=%"PRId64, peak);
+}
+
+void xapi_psyncsmooth(void *d) {
+	int locked;
+	double err, avg, peak, rate;
+	uint64_t resets;
+	syncsmooth_stats (&locked, &err, &avg, &peak, &rate, &resets);
+	remote_printf(201,"syncsmooth=%i", want_syncsmooth);
+	remote_printf(201,"syncsmoothbw=%g", syncsmooth_bw);
+	remote_printf(201,"synclocked=%i", locked);
+	remote_printf(201,"syncrate=%.4f", rate);
+	remote_printf(201,"syncerror=%.4f", err);
+	remote_printf(201,"syncerroravg=%.4f", avg);
+	remote_printf(201,"syncerrorpeak=%.4f", peak);
+	remote_printf(201,"syncresets=%"PRIu64, resets);
+}
+
+void xapi_ssyncsmooth(void *d) {
+	char *t1;
+	want_syncsmooth = atoi((char*)d);
+	if ((t1=strchr((char*)d,' ')) && ++t1 && atof(t1) > 0) {
+		syncsmooth_bw = atof(t1);
+	}
+	remote_printf(101,"syncsmooth=%i", want_syncsmooth);
+}
+
 void xapi_soffset(void *d) {
 	ts_offset = smptestring_to_frame((char*)d);
 	remote_printf(101,"offset=%"PRId64, ts_offset);
@@ -502,9 +565,13 @@ static void xapi_jack_status(void *d) {
 }
 
 void xapi_ltc_status(void *d) {
-	if (ltcjack_connected())
+	if (ltcjack_connected()) {
+		uint64_t decoded, dropped;
+		ltc_stats (&decoded, &dropped);
 		remote_printf(220,"jackclient=%s", xj_jack_client_name());
-	else
+		remote_printf(201,"ltcframes=%"PRIu64, decoded);
+		remote_printf(201,"ltcdropped=%"PRIu64, dropped);
+	} else
 		remote_printf(100,"no open LTC JACK source");
 }
 
@@ -893,7 +960,7 @@ static Dcommand cmd_jack[] = {
 static Dcommand cmd_ltc[] = {
 	{"connect", ": connect and sync to LTC server", NULL, xapi_open_ltc , 0 },
 	{"disconnect", ": disconnect from LTC", NULL, xapi_close_ltc , 0 },
-	{"status", ": get status of jack connection", NULL, xapi_ltc_status , 0 },
+	{"status", ": get status of jack connection, decoded and dropped LTC frames", NULL, xapi_ltc_status , 0 },
 	{NULL, NULL, NULL , NULL, 0}
 };
 
@@ -928,6 +995,11 @@ static Dcommand cmd_get[] = {
 	{"framerate", ": show frame rate of video file", NULL, xapi_pframerate , 0 },
 	{"width", ": query width of video source buffer", NULL, xapi_pmwidth , 0 },
 	{"height", ": query width of video source buffer", NULL, xapi_pmheight , 0 },
+	{"framecache", ": show decoded frame cache statistics", NULL, xapi_pframecache , 0 },
+	{"redraws", ": show number of redraws that did not decode the frame again", NULL, xapi_predraws , 0 },
+	{"pacing", ": show number of presented and skipped frames, mean and deviation of the frame interval [ms]", NULL, xapi_ppacing , 0 },
+	{"conversion", ": show pixel-format conversion time per frame [us]", NULL, xapi_pconversion , 0 },
+	{"syncsmooth", ": show sync smoothing setting and phase error [frames]", NULL, xapi_psyncsmooth , 0 },
 
 	{"seekmode", ": deprecated - no return value", NULL, xapi_pseekmode, 0 },
 	{"windowsize" , ": show current window size", NULL, xapi_pwinsize, 0 },
@@ -986,6 +1058,7 @@ static Dcommand cmd_set[] = {
 	{"seekmode ", ": deprecated - no operation", NULL, xapi_sseekmode, 0 },
 	{"timescale ", "<float> <int>: set timescale and offset (*)", NULL, xapi_stimescale , 0 },
 	{"loop ", "<int>: 0: normal, 1:wrap around (*)", NULL, xapi_sloop , 0 },
+	{"syncsmooth ", "<int> [<float>]: smooth sync sources (bitmask 1:jack 2:MTC 4:LTC) and loop bandwidth [Hz]", NULL, xapi_ssyncsmooth , 0 },
 	{NULL, NULL, NULL , NULL, 0}
 };
 
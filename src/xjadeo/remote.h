@@ -33,6 +33,12 @@ void xapi_pseekmode (void *d);
 void xapi_sseekmode (void *d);
 void xapi_pmwidth(void *d);
 void xapi_pmheight(void *d);
+void xapi_pframecache(void *d);
+void xapi_pconversion(void *d);
+void xapi_predraws(void *d);
+void xapi_ppacing(void *d);
+void xapi_psyncsmooth(void *d);
+void xapi_ssyncsmooth(void *d);
 void xapi_soffset(void *d);
 void xapi_stimescale(void *d);
 void xapi_sloop(void *d);
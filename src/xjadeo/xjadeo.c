@@ -22,8 +22,13 @@
 
 #include "ffcompat.h"
 #include <libswscale/swscale.h>
+#include <libavutil/cpu.h>
+#include <libavutil/pixdesc.h>
 #include <pthread.h>
 #include <assert.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "remote.h"
 #include "gtime.h"
@@ -87,6 +92,17 @@ extern char    *ipc_queue;
 extern double   delay;
 extern int      keyframe_interval_limit;
 extern int      want_noindex;
+extern int      frame_cache_mb;
+extern int      readahead_frames;
+extern int      decoder_threads;
+extern int      scale_threads;
+extern int      want_prescale;
+extern int      want_syncsmooth;
+extern double   syncsmooth_bw;
+extern int      want_letterbox;
+extern int      want_idxcache;
+extern int      index_threads;
+extern int      want_idxinline;
 #ifdef HAVE_LTC
 extern int  use_ltc;
 #endif
@@ -101,6 +117,9 @@ extern char OSD_nfo_geo[5][48];
 uint64_t    osd_smpte_ts;
 uint64_t    osd_vtc_oob;
 
+// display.c
+void stride_memcpy(void * dst, const void * src, int width, int height, int dstStride, int srcStride);
+
 //------------------------------------------------
 // globals
 //------------------------------------------------
@@ -111,19 +130,32 @@ double  timescale = 1.0;
 int     wraparound = 0;
 #endif
 
-struct FrameIndex {
+/* frame index
+ *  - kfidx: every keyframe in decode order, allocated in blocks
+ *    of KF_BLOCK entries (blocks never move while the index grows).
+ *  - fidx: per frame, the keyframe to seek to (-1: none).
+ * The timestamp of frame [i] is derived from its number.
+ * In direct mode (all frames are keyframes), neither table is used.
+ */
+struct KeyframeIndex {
+	int64_t frame; ///< frame number (decode order)
 	int64_t pkt_pts;
 	int64_t pkt_pos;
 	int64_t frame_pts;
 	int64_t frame_pos;
-	int64_t timestamp; //< corresponds to array's [i]
-	//int64_t frame_num; //< corresponds to frame_pts;
-	int64_t seekpts;
-	int64_t seekpos;
-	uint8_t key;
 };
 
-static struct FrameIndex *fidx = NULL;
+#define KF_BLOCK_BITS (10)
+#define KF_BLOCK (1 << KF_BLOCK_BITS)
+#define KF(k) (&kfidx[(k) >> KF_BLOCK_BITS][(k) & (KF_BLOCK - 1)])
+
+static struct KeyframeIndex **kfidx = NULL;
+static int64_t kfblocks = 0;
+static int64_t kfcnt = 0;
+static int32_t *fidx = NULL;
+static uint8_t idx_direct = 0;
+static int64_t idx_first_pts = -1; ///< PTS of the first packet
+static int64_t idx_ts_offset = 0;  ///< frame-offset of timestamps
 
 static int64_t last_decoded_pts = -1;
 static int64_t last_decoded_frameno = -1;
@@ -134,10 +166,88 @@ static uint8_t scan_complete = 0;
 static uint8_t thread_active = 0;
 static uint8_t byte_seek = 0;
 static uint8_t pts_warn = 0;
+static int decoder_delay = 0; ///< max. number of frames held back by frame-threading
+
+/* the index is built in chunks of IDX2_CHUNK frames, frames of a
+ * chunk can be displayed once its seek-table entries are final. */
+#define IDX2_CHUNK (64)
+
+#define IDX_CHUNK_PENDING  (0)
+#define IDX_CHUNK_BUSY     (1)
+#define IDX_CHUNK_VERIFIED (2)
+#define IDX_CHUNK_FINAL    (3)
+
+static uint8_t *idx_chunk = NULL;   ///< IDX_CHUNK_* state of every chunk
+static int64_t  idx_nchunks = 0;
+static int64_t  idx_priority = -1;  ///< frame requested by the display
+
+/* Chunks are published to the display and read-ahead threads without
+ * a lock: the index thread writes fidx[] and the keyframe table, then
+ * issues a barrier before marking the chunk final (or setting
+ * scan_complete). Readers issue a barrier after seeing that state,
+ * before they look at the index.
+ */
+static void idx_chunk_publish (const int64_t c) {
+	__sync_synchronize ();
+	idx_chunk[c] = IDX_CHUNK_FINAL;
+}
+
+static int index_ready (const int64_t framenumber) {
+	int rv;
+	if (scan_complete) {
+		rv = 1;
+	} else if (!idx_chunk || framenumber < 0 || framenumber >= frames) {
+		return 0;
+	} else {
+		rv = idx_chunk[framenumber / IDX2_CHUNK] == IDX_CHUNK_FINAL;
+	}
+	__sync_synchronize ();
+	return rv;
+}
 
 static pthread_t index_thread;
 
+static struct KeyframeIndex *kf_add (const int64_t frame) {
+	const int64_t b = kfcnt >> KF_BLOCK_BITS;
+	if (b >= kfblocks) {
+		return NULL;
+	}
+	if (!kfidx[b] && !(kfidx[b] = malloc (KF_BLOCK * sizeof (struct KeyframeIndex)))) {
+		return NULL;
+	}
+	struct KeyframeIndex *kf = KF(kfcnt);
+	kf->frame = frame;
+	kf->pkt_pts = kf->pkt_pos = -1;
+	kf->frame_pts = kf->frame_pos = -1;
+	__sync_synchronize ();
+	++kfcnt;
+	return kf;
+}
+
+/* number of keyframes, the entries below it can be read */
+static int64_t kf_count (void) {
+	const int64_t n = kfcnt;
+	__sync_synchronize ();
+	return n;
+}
+
+/* last keyframe at or before the given frame, -1 if none */
+static int64_t kf_find (const int64_t frame) {
+	int64_t lo = 0, hi = kf_count () - 1;
+	if (hi < 0 || KF(0)->frame > frame) return -1;
+	while (lo < hi) {
+		const int64_t mid = lo + (hi - lo + 1) / 2;
+		if (KF(mid)->frame <= frame) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
 static AVRational fr_Q = { 1, 1 };
+static AVRational idx_tb = { 1, 1 };
 static int64_t    one_frame;
 static int        fFirstTime=1;
 static uint8_t    syncnidx = 0;
@@ -149,6 +259,25 @@ static const char syncname[4][5] =
 	"MTC "
 };
 
+static int64_t frame_timestamp (const int64_t i) {
+	return av_rescale_q (idx_ts_offset + i, fr_Q, idx_tb);
+}
+
+/* the seek-point of a frame; in direct mode every frame is one */
+static int64_t seek_entry (const int64_t i) {
+	return idx_direct ? i : fidx[i];
+}
+
+static int64_t seek_pts (const int64_t i) {
+	if (idx_direct) return idx_first_pts + av_rescale_q (i, fr_Q, idx_tb);
+	return fidx[i] < 0 ? 0 : KF(fidx[i])->pkt_pts;
+}
+
+static int64_t seek_pos (const int64_t i) {
+	if (idx_direct) return -1;
+	return fidx[i] < 0 ? 0 : KF(fidx[i])->frame_pos;
+}
+
 
 #ifdef JACK_SESSION
 extern int jack_session_restore;
@@ -215,10 +344,210 @@ static int select_sleep (const long usec) {
 	return remote_activity;
 }
 
+//--------------------------------------------
+// window-size aware pre-scaling
+//--------------------------------------------
+
+/* With --prescale the render buffer (movie_width x movie_height)
+ * follows the size of the displayed image, so that swscale
+ * down-scales once and the video output does not need to convert,
+ * copy and upload full-resolution frames for a small window.
+ * The OSD is rendered into the buffer and hence remains 1:1.
+ * It is never enlarged beyond the source size, up-scaling is left
+ * to the video output.
+ */
+static int     source_width = 0;  // movie size without pre-scaling
+static int     source_height = 0;
+static int     prescale_w = 0;    // pending target size
+static int     prescale_h = 0;
+static int64_t prescale_since = 0;
+
+static void prescale_target (int *tw, int *th) {
+	const float asp = movie_aspect ? movie_aspect : (float)source_width / (float)source_height;
+	unsigned int w, h;
+	Xgetsize (&w, &h);
+
+	if (want_letterbox) {
+		if ((float)w / (float)h > asp) {
+			w = rintf ((float)h * asp);
+		} else {
+			h = rintf ((float)w / asp);
+		}
+	}
+
+	*tw = MAX(32, MIN((int)w, source_width));
+	*th = MAX(32, MIN((int)h, source_height));
+
+	if (render_fmt != AV_PIX_FMT_RGB24 && render_fmt != AV_PIX_FMT_BGRA32) {
+		*tw &= ~1;
+		*th &= ~1;
+	}
+}
+
+/* called from the event-loop. The buffers are re-allocated once
+ * the window-size has settled, not for every step of a resize.
+ */
+static void prescale_check (void) {
+	int tw, th;
+	int64_t now;
+	if (!want_prescale || !pFrameFMT || source_width < 1 || source_height < 1) return;
+	if (getvidmode () == VO_AUTO || getvidmode () == VO_MAC) return;
+
+	prescale_target (&tw, &th);
+	if (tw == movie_width && th == movie_height) {
+		prescale_w = prescale_h = 0;
+		return;
+	}
+
+	now = xj_get_monotonic_time ();
+	if (tw != prescale_w || th != prescale_h) {
+		prescale_w = tw;
+		prescale_h = th;
+		prescale_since = now;
+		return;
+	}
+	if (now - prescale_since < 250000) return;
+
+	if (want_verbose) {
+		printf("pre-scaling video to %dx%d px\n", tw, th);
+	}
+	prescale_w = prescale_h = 0;
+	movie_width  = tw;
+	movie_height = th;
+	init_moviebuffer ();
+	newsourcebuffer ();
+	force_redraw = 1;
+}
+
+//--------------------------------------------
+// sync clock smoothing
+//--------------------------------------------
+
+/* A delay-locked loop that interpolates the sync position between
+ * updates of the sync source. With large JACK periods (or LTC that
+ * is decoded once per period) the polled position only changes once
+ * per cycle, and the picture advances in bursts of several frames.
+ *
+ * The loop is fed at every change of the polled frame-number: at
+ * that moment the actual position is just past the new value.
+ * In between it extrapolates using the filtered rate. The output is
+ * monotonic and never behind the polled position.
+ *
+ * Any discontinuity (locate, reverse, stop, stall, change of sync
+ * source) resets the loop and passes the polled position through
+ * until the source is seen to advance again.
+ */
+
+static int     dll_locked = 0;
+static uint8_t dll_source = 0;
+static int64_t dll_obs  = 0;    ///< last polled frame
+static int64_t dll_time = 0;    ///< [us] time when dll_obs was first seen
+static int64_t dll_out  = 0;    ///< last returned frame
+static double  dll_pos  = 0;    ///< filtered position at dll_time [frames]
+static double  dll_rate = 0;    ///< filtered speed [frames / sec]
+static double  dll_gap  = 0;    ///< average interval between updates [sec]
+
+static double   dll_err_last = 0;
+static double   dll_err_avg  = 0;
+static double   dll_err_peak = 0;
+static uint64_t dll_resets   = 0;
+
+static void syncsmooth_reset (void) {
+	if (dll_locked) ++dll_resets;
+	dll_locked = 0;
+}
+
+void syncsmooth_stats (int *locked, double *err, double *avg, double *peak, double *rate, uint64_t *resets) {
+	*locked = dll_locked;
+	*err    = dll_err_last;
+	*avg    = dll_err_avg;
+	*peak   = dll_err_peak;
+	*rate   = dll_locked ? dll_rate : 0;
+	*resets = dll_resets;
+}
+
+static int64_t syncsmooth (int64_t frame, uint8_t stopped) {
+	/* syncnidx to want_syncsmooth bit, same order as the 'syncsource' setting */
+	static const int source_bit[4] = { 0, 1, 4, 2 };
+	const int64_t now = xj_get_monotonic_time ();
+	double dt, pred, err;
+
+	if (!(want_syncsmooth & source_bit[syncnidx]) || framerate <= 0) {
+		syncsmooth_reset ();
+		return frame;
+	}
+
+	/* largest expected step of the source: 250ms worth of frames */
+	const int64_t max_step = 2 + ceil (.25 * framerate);
+
+	if (!dll_locked) {
+		/* wait for the source to advance, then lock to the nominal speed */
+		if (dll_source == syncnidx && !stopped && frame > dll_obs && frame <= dll_obs + max_step) {
+			dll_locked = 1;
+			dll_pos  = frame + .5;
+			dll_rate = framerate;
+			dll_gap  = 1. / framerate;
+			dll_time = now;
+			dll_out  = frame;
+			dll_err_last = dll_err_avg = dll_err_peak = 0;
+		}
+		dll_source = syncnidx;
+		dll_obs = frame;
+		return frame;
+	}
+
+	dt = (now - dll_time) * 1e-6;
+
+	if (dll_source != syncnidx || stopped || frame < dll_obs || frame > dll_obs + max_step
+			|| (frame == dll_obs && dt > 4. * dll_gap + .1)) {
+		syncsmooth_reset ();
+		dll_source = syncnidx;
+		dll_obs = frame;
+		return frame;
+	}
+
+	/* the source advanced: update the loop. Two updates within the
+	 * same clock tick (dt == 0) would divide by zero, the second one
+	 * is folded into the next update. */
+	if (frame != dll_obs && dt > 0) {
+		pred = dll_pos + dll_rate * dt;
+		err  = (frame + .5) - pred;
+		if (fabs (err) > max_step) {
+			syncsmooth_reset ();
+			dll_obs = frame;
+			return frame;
+		}
+
+		double omega = 2. * M_PI * syncsmooth_bw * dt;
+		if (omega > 1.) omega = 1.;
+		dll_pos   = pred + 1.4142135623730950488 * omega * err; // sqrt(2)
+		dll_rate += omega * omega * err / dt;
+		dll_gap  += .1 * (dt - dll_gap);
+		dll_time  = now;
+		dll_obs   = frame;
+		dt = 0;
+
+		dll_err_last = err;
+		dll_err_avg += .05 * (fabs (err) - dll_err_avg);
+		if (fabs (err) > dll_err_peak) dll_err_peak = fabs (err);
+	}
+
+	/* extrapolate, but not much further than the next expected update */
+	if (dt > 1.5 * dll_gap) dt = 1.5 * dll_gap;
+	int64_t out = floor (dll_pos + dll_rate * dt);
+	if (out < dll_out) out = dll_out;
+	if (out < frame) out = frame;
+	if (out > frame + max_step) out = frame + max_step;
+	dll_out = out;
+	return out;
+}
+
 //--------------------------------------------
 // main event loop
 //--------------------------------------------
 static void cancel_index_thread (void);
+static void readahead_predict (int64_t frame, uint8_t stopped);
+static void readahead_stop (void);
 uint8_t splashed = 0;
 
 void event_loop (void) {
@@ -277,43 +606,7 @@ void event_loop (void) {
 			prev_syncidx = syncnidx;
 		}
 
-#if 0 // experimental PLL
-		static uint8_t dll_initialized = 0;
-		static double dll_e2, dll_e0;
-		static double dll_t0, dll_t1;
-		static double dll_b, dll_c;
-		static double dll_frameno;
-		static int64_t prevFrame = 0;
-		if (!scan_complete) dll_initialized = 0;
-		if (syncnidx != 3) {
-			// USE DLL to smooth over large jack cycles
-			// with jack -> we know transport rolling state -> use it
-			// this still jitters on start/stop,:( more work is needed.
-			if (newFrame < prevFrame || newFrame > prevFrame + 4 || we_know_transport_is_not_rolling || !dll_initialized) {
-				// reset DLL
-				dll_initialized = 1;
-				dll_e0 = dll_t0 = 0;
-				dll_e2 = (delay > 0) ? (.5 * framerate * (float)delay) : .2;
-				dll_t1 = newFrame + dll_e2;
-
-				const double omega = 2. * M_PI / framerate;
-				dll_b = 1.4142135623730950488 * omega; // sqrt(2)
-				dll_c = omega * omega;
-				if (!want_quiet && !we_know_transport_is_not_rolling)
-					printf("RE-INIT DLL %g %lld <> %lld\n", dll_e2, prevFrame, newFrame);
-				prevFrame = newFrame;
-			} else {
-				double expect = prevFrame + (xj_get_monotonic_time() - clock1) * framerate / 1000000.f;
-				dll_e0 = expect - dll_t1;
-				dll_t0 = dll_t1;
-				dll_t1 += dll_b * dll_e0 + dll_e2;
-				dll_e2 += dll_c * dll_e0;
-				//printf("%.1f %+7.4f %lld %s\n", dll_t1, dll_e0, newFrame,  floor(dll_t1) != newFrame ? "!":"");
-				prevFrame = newFrame;
-				newFrame = floor(dll_t1);
-			}
-		}
-#endif
+		newFrame = syncsmooth (newFrame, we_know_transport_is_not_rolling);
 
 #if 0 // DEBUG
 		static int64_t oldFrame = 0;
@@ -335,6 +628,7 @@ void event_loop (void) {
 #endif
 
 		offFrame = newFrame + ts_offset;
+		readahead_predict (offFrame, we_know_transport_is_not_rolling);
 		int64_t curFrame = dispFrame;
 		const int fd = force_redraw;
 		force_redraw = 0;
@@ -372,6 +666,7 @@ void event_loop (void) {
 
 		handle_X_events();
 		js_apply();
+		prescale_check ();
 
 		clock2 = xj_get_monotonic_time();
 		nominal_delay *= 1000000.f;
@@ -410,6 +705,7 @@ void event_loop (void) {
 		xapi_pwinsize (NULL);
 		xapi_poffset (NULL);
 	}
+	readahead_stop();
 	cancel_index_thread();
 }
 
@@ -422,13 +718,567 @@ static void render_empty_frame (int blit, int splashagain);
 static uint8_t displaying_valid_frame = 0;
 
 static int vbufsize = 0;
+static uint8_t *moviebuffer = NULL; ///< allocated by init_moviebuffer()
 
 size_t video_buffer_size() {
 	return vbufsize;
 }
 
+/* let the video output provide the memory for the next frame,
+ * e.g. a shared-memory image that it can display without copying.
+ * The buffer must hold vbufsize bytes in render_fmt's layout.
+ * NULL reverts to xjadeo's own buffer.
+ */
+void redirect_moviebuffer (uint8_t *buf) {
+	buffer = buf ? buf : moviebuffer;
+	if (pFrameFMT && buffer) {
+		avpicture_fill ((AVPicture *)pFrameFMT, buffer, render_fmt, movie_width, movie_height);
+	}
+}
+
+//--------------------------------------------
+// decoded frame cache
+//--------------------------------------------
+
+/* keep recently displayed frames, converted to render_fmt,
+ * so that jogging back and forth does not need to seek and
+ * re-decode a complete GOP for every step.
+ */
+#define FRAME_CACHE_MAX_ENTRIES (512)
+
+struct FrameCacheEntry {
+	int64_t  frame;
+	int      fmt;
+	uint64_t stamp; ///< LRU counter, highest value is most recently used
+	uint8_t *data;
+};
+
+static struct FrameCacheEntry *fcache = NULL;
+static int      fcache_size  = 0; ///< max. number of entries for current vbufsize
+static int      fcache_used  = 0;
+static uint64_t fcache_stamp = 0;
+static uint64_t fcache_hits  = 0;
+static uint64_t fcache_miss  = 0;
+
+static pthread_mutex_t fcache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void frame_cache_free (void) {
+	int i;
+	for (i = 0; i < fcache_used; ++i) {
+		free (fcache[i].data);
+	}
+	free (fcache);
+	fcache = NULL;
+	fcache_size = 0;
+	fcache_used = 0;
+}
+
+static void frame_cache_init (void) {
+	frame_cache_free ();
+	if (frame_cache_mb <= 0 || vbufsize <= 0) {
+		return;
+	}
+	fcache_size = MIN(FRAME_CACHE_MAX_ENTRIES, ((int64_t)frame_cache_mb * 1048576) / vbufsize);
+	if (readahead_frames > 0 && fcache_size < 2 * readahead_frames + 2) {
+		/* read-ahead needs room for the predicted frames in addition
+		 * to the ones on screen, large frames would disable it */
+		fcache_size = MIN(FRAME_CACHE_MAX_ENTRIES, 2 * readahead_frames + 2);
+		if (!want_quiet)
+			fprintf(stderr, "Frame cache: %d MB is too small for %d read-ahead frames, using %d MB "
+					"(see --frame-cache and --read-ahead).\n",
+					frame_cache_mb, readahead_frames,
+					(int)(((int64_t)fcache_size * vbufsize + 1048575) / 1048576));
+	}
+	if (fcache_size < 2) {
+		fcache_size = 0;
+		return;
+	}
+	fcache = calloc (fcache_size, sizeof (struct FrameCacheEntry));
+	if (!fcache) {
+		fcache_size = 0;
+	}
+	if (want_debug)
+		printf("DEBUG: frame cache: %d entries of %d bytes\n", fcache_size, vbufsize);
+}
+
+static int frame_cache_find (int64_t frame) {
+	int i;
+	for (i = 0; i < fcache_used; ++i) {
+		if (fcache[i].frame == frame && fcache[i].fmt == render_fmt) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int frame_cache_has (int64_t frame) {
+	int rv;
+	pthread_mutex_lock (&fcache_lock);
+	rv = frame_cache_find (frame) >= 0;
+	pthread_mutex_unlock (&fcache_lock);
+	return rv;
+}
+
+static int frame_cache_get (int64_t frame, uint8_t *dst) {
+	int i;
+	if (fcache_size == 0) return -1;
+	pthread_mutex_lock (&fcache_lock);
+	if ((i = frame_cache_find (frame)) < 0) {
+		++fcache_miss;
+		pthread_mutex_unlock (&fcache_lock);
+		return -1;
+	}
+	fcache[i].stamp = ++fcache_stamp;
+	memcpy (dst, fcache[i].data, vbufsize);
+	++fcache_hits;
+	pthread_mutex_unlock (&fcache_lock);
+	return 0;
+}
+
+/* like frame_cache_get(), but does not count as a cache access:
+ * used to restore the pristine frame for OSD-only redraws.
+ */
+static int frame_cache_peek (int64_t frame, uint8_t *dst) {
+	int i;
+	if (fcache_size == 0) return -1;
+	pthread_mutex_lock (&fcache_lock);
+	if ((i = frame_cache_find (frame)) < 0) {
+		pthread_mutex_unlock (&fcache_lock);
+		return -1;
+	}
+	memcpy (dst, fcache[i].data, vbufsize);
+	pthread_mutex_unlock (&fcache_lock);
+	return 0;
+}
+
+static void frame_cache_put (int64_t frame, const uint8_t *src) {
+	struct FrameCacheEntry *e = NULL;
+	int i;
+	if (fcache_size == 0) return;
+
+	pthread_mutex_lock (&fcache_lock);
+	if (frame_cache_find (frame) >= 0) {
+		pthread_mutex_unlock (&fcache_lock);
+		return;
+	}
+	if (fcache_used < fcache_size) {
+		uint8_t *data = malloc (vbufsize);
+		if (data) {
+			e = &fcache[fcache_used++];
+			e->data = data;
+		}
+	}
+	if (!e) {
+		// evict least recently used entry
+		for (i = 0; i < fcache_used; ++i) {
+			if (!e || fcache[i].stamp < e->stamp) {
+				e = &fcache[i];
+			}
+		}
+	}
+	if (e) {
+		e->frame = frame;
+		e->fmt   = render_fmt;
+		e->stamp = ++fcache_stamp;
+		memcpy (e->data, src, vbufsize);
+	}
+	pthread_mutex_unlock (&fcache_lock);
+}
+
+void frame_cache_stats (uint64_t *hits, uint64_t *misses, int *used, int *size) {
+	pthread_mutex_lock (&fcache_lock);
+	if (hits)   *hits   = fcache_hits;
+	if (misses) *misses = fcache_miss;
+	if (used)   *used   = fcache_used;
+	if (size)   *size   = fcache_size;
+	pthread_mutex_unlock (&fcache_lock);
+}
+
+//--------------------------------------------
+// pixel format conversion
+//--------------------------------------------
+
+/* swscale contexts are kept across file and video-output changes,
+ * keyed by source and destination geometry, format and flags.
+ */
+#define SWS_CACHE_SIZE (4)
+
+struct SwsCacheEntry {
+	struct SwsContext *ctx;
+	int src_w, src_h, src_fmt;
+	int dst_w, dst_h, dst_fmt;
+	int flags;
+	uint64_t stamp;
+};
+
+static struct SwsCacheEntry sws_cache[SWS_CACHE_SIZE];
+static uint64_t sws_cache_stamp = 0;
+
+/* negotiated per init_moviebuffer() */
+static int render_stride[8] = {0,0,0,0,0,0,0,0};
+static int render_copy = 0; // decoder output matches render_fmt, skip swscale
+
+/* conversion timing, updated by decode_frame() */
+static uint64_t conv_frames = 0;
+static int64_t  conv_last = 0;
+static int64_t  conv_total = 0;
+static int64_t  conv_peak = 0;
+
+static void sws_slices_stop (void);
+
+static struct SwsContext *sws_cache_get (int src_w, int src_h, int src_fmt, int dst_w, int dst_h, int dst_fmt, int flags) {
+	struct SwsCacheEntry *e = NULL;
+	int i;
+	for (i = 0; i < SWS_CACHE_SIZE; ++i) {
+		struct SwsCacheEntry *c = &sws_cache[i];
+		if (c->ctx
+				&& c->src_w == src_w && c->src_h == src_h && c->src_fmt == src_fmt
+				&& c->dst_w == dst_w && c->dst_h == dst_h && c->dst_fmt == dst_fmt
+				&& c->flags == flags) {
+			c->stamp = ++sws_cache_stamp;
+			return c->ctx;
+		}
+		// prefer an unused slot, else evict the least recently used one
+		if (!e || (e->ctx && (!c->ctx || c->stamp < e->stamp))) {
+			e = c;
+		}
+	}
+	if (e->ctx) {
+		sws_freeContext (e->ctx);
+	}
+	e->ctx = sws_getContext (src_w, src_h, src_fmt, dst_w, dst_h, dst_fmt, flags, NULL, NULL, NULL);
+	e->src_w = src_w; e->src_h = src_h; e->src_fmt = src_fmt;
+	e->dst_w = dst_w; e->dst_h = dst_h; e->dst_fmt = dst_fmt;
+	e->flags = flags;
+	e->stamp = ++sws_cache_stamp;
+	if (want_debug) {
+		printf("DEBUG: new swscale context %dx%d/%d -> %dx%d/%d\n",
+				src_w, src_h, src_fmt, dst_w, dst_h, dst_fmt);
+	}
+	return e->ctx;
+}
+
+void sws_cache_free (void) {
+	int i;
+	sws_slices_stop ();
+	for (i = 0; i < SWS_CACHE_SIZE; ++i) {
+		if (sws_cache[i].ctx) {
+			sws_freeContext (sws_cache[i].ctx);
+		}
+		sws_cache[i].ctx = NULL;
+	}
+}
+
+static void render_fmt_stride (int *dstStride) {
+	memset (dstStride, 0, 8 * sizeof (int));
+	switch (render_fmt) {
+		case AV_PIX_FMT_RGBA32:
+		case AV_PIX_FMT_BGRA32:
+			dstStride[0] = movie_width*4;
+			break;
+		case AV_PIX_FMT_BGR24:
+			dstStride[0] = movie_width*3;
+			break;
+		case AV_PIX_FMT_UYVY422:
+			dstStride[0] = movie_width*2;
+			break;
+		case AV_PIX_FMT_YUV420P:
+		default:
+			dstStride[0] = movie_width;
+			dstStride[1] = movie_width/2;
+			dstStride[2] = movie_width/2;
+	}
+}
+
+/* plain plane copy, used when the decoder already outputs render_fmt
+ * at the movie size */
+static void copy_frame_planes (uint8_t * const *dst) {
+	switch (render_fmt) {
+		case AV_PIX_FMT_YUV420P:
+			stride_memcpy (dst[0], pFrame->data[0], movie_width, movie_height, render_stride[0], pFrame->linesize[0]);
+			stride_memcpy (dst[1], pFrame->data[1], movie_width/2, movie_height/2, render_stride[1], pFrame->linesize[1]);
+			stride_memcpy (dst[2], pFrame->data[2], movie_width/2, movie_height/2, render_stride[2], pFrame->linesize[2]);
+			break;
+		default:
+			stride_memcpy (dst[0], pFrame->data[0], render_stride[0], movie_height, render_stride[0], pFrame->linesize[0]);
+			break;
+	}
+}
+
+/* Large frames are converted in horizontal slices, one swscale
+ * context per slice. The calling thread converts the first slice,
+ * a pool of workers the others. Slicing is only used if source and
+ * destination have the same height (no vertical scaling), slice
+ * boundaries are aligned to the vertical chroma subsampling.
+ */
+#ifdef AV_PIX_FMT_FLAG_PAL
+# define SWS_SLICED
+#endif
+
+#define SWS_MAX_SLICES (16)
+
+#ifdef SWS_SLICED
+struct SwsSlice {
+	struct SwsContext *ctx;
+	int y; // first row
+	int h; // number of rows
+};
+
+static struct SwsSlice sws_slice[SWS_MAX_SLICES];
+static int sws_nslices = 0;
+static const AVPixFmtDescriptor *sws_src_desc = NULL;
+static const AVPixFmtDescriptor *sws_dst_desc = NULL;
+
+static pthread_t       sws_worker_thread[SWS_MAX_SLICES];
+static pthread_mutex_t sws_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  sws_pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  sws_pool_done = PTHREAD_COND_INITIALIZER;
+static int             sws_pool_run = 0;
+static unsigned int    sws_pool_job = 0;
+static int             sws_pool_pending = 0;
+
+static uint8_t * const *sws_job_src = NULL;
+static const int       *sws_job_stride = NULL;
+static uint8_t * const *sws_job_dst = NULL;
+
+static int slice_align (const AVPixFmtDescriptor *d) {
+	int p, planes = 0;
+	if (!d) return 0;
+	if (d->flags & AV_PIX_FMT_FLAG_PAL) return 0;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+	if (d->flags & AV_PIX_FMT_FLAG_PSEUDOPAL) return 0;
+#endif
+	for (p = 0; p < d->nb_components; ++p) {
+		planes = MAX(planes, d->comp[p].plane + 1);
+	}
+	if (planes < 1) return 0;
+	return 1 << d->log2_chroma_h;
+}
+
+static void slice_planes (const AVPixFmtDescriptor *d, uint8_t * const *in, const int *stride, int y, uint8_t **out) {
+	int p;
+	for (p = 0; p < 4; ++p) {
+		const int shift = (p == 1 || p == 2) ? d->log2_chroma_h : 0;
+		out[p] = in[p] ? in[p] + (y >> shift) * stride[p] : NULL;
+	}
+}
+
+static void sws_convert_slice (int i) {
+	struct SwsSlice *s = &sws_slice[i];
+	uint8_t *src[4];
+	uint8_t *dst[4];
+	slice_planes (sws_src_desc, sws_job_src, sws_job_stride, s->y, src);
+	slice_planes (sws_dst_desc, sws_job_dst, render_stride, s->y, dst);
+	sws_scale (s->ctx, (const uint8_t * const*)src, sws_job_stride, 0, s->h, dst, render_stride);
+}
+
+static void *sws_worker (void *arg) {
+	const int i = (int)(intptr_t)arg;
+	unsigned int job = 0;
+	pthread_mutex_lock (&sws_pool_lock);
+	while (1) {
+		while (sws_pool_run && sws_pool_job == job) {
+			pthread_cond_wait (&sws_pool_wake, &sws_pool_lock);
+		}
+		if (!sws_pool_run) break;
+		job = sws_pool_job;
+		pthread_mutex_unlock (&sws_pool_lock);
+		sws_convert_slice (i);
+		pthread_mutex_lock (&sws_pool_lock);
+		if (--sws_pool_pending == 0) {
+			pthread_cond_signal (&sws_pool_done);
+		}
+	}
+	pthread_mutex_unlock (&sws_pool_lock);
+	return NULL;
+}
+
+static void sws_slices_stop (void) {
+	int i;
+	if (sws_nslices == 0) return;
+	pthread_mutex_lock (&sws_pool_lock);
+	sws_pool_run = 0;
+	pthread_cond_broadcast (&sws_pool_wake);
+	pthread_mutex_unlock (&sws_pool_lock);
+	for (i = 1; i < sws_nslices; ++i) {
+		pthread_join (sws_worker_thread[i], NULL);
+	}
+	for (i = 0; i < sws_nslices; ++i) {
+		sws_freeContext (sws_slice[i].ctx);
+		sws_slice[i].ctx = NULL;
+	}
+	sws_nslices = 0;
+}
+
+static void sws_slices_start (int src_w, int src_h, int src_fmt) {
+	int i, n, rows, align;
+	sws_slices_stop ();
+
+	if (src_h != movie_height) return;
+	sws_src_desc = av_pix_fmt_desc_get (src_fmt);
+	sws_dst_desc = av_pix_fmt_desc_get (render_fmt);
+	if (!slice_align (sws_src_desc) || !slice_align (sws_dst_desc)) return;
+	align = MAX(slice_align (sws_src_desc), slice_align (sws_dst_desc));
+
+	if (scale_threads > 0) {
+		n = scale_threads;
+	} else {
+		// one slice per 540 rows, HD: 2, UHD: 4
+		n = MIN(av_cpu_count (), movie_height / 540);
+	}
+	n = MIN(n, SWS_MAX_SLICES);
+	rows = ((movie_height / MAX(n, 1)) + align - 1) & ~(align - 1);
+	if (rows < 1) return;
+	n = MIN(n, (movie_height + rows - 1) / rows);
+	if (n < 2) return;
+
+	for (i = 0; i < n; ++i) {
+		struct SwsSlice *s = &sws_slice[i];
+		s->y = i * rows;
+		s->h = (i == n - 1) ? movie_height - s->y : rows;
+		s->ctx = sws_getContext (src_w, s->h, src_fmt, movie_width, s->h, render_fmt, SWS_BICUBIC, NULL, NULL, NULL);
+		if (!s->ctx) {
+			while (--i >= 0) {
+				sws_freeContext (sws_slice[i].ctx);
+				sws_slice[i].ctx = NULL;
+			}
+			return;
+		}
+	}
+
+	sws_pool_run = 1;
+	sws_pool_job = 0;
+	for (i = 1; i < n; ++i) {
+		if (pthread_create (&sws_worker_thread[i], NULL, sws_worker, (void*)(intptr_t)i)) {
+			break;
+		}
+	}
+	sws_nslices = i;
+	if (i < n) {
+		// could not start all workers, fall back to a single swscale context
+		if (!want_quiet)
+			fprintf(stderr, "Failed to start conversion threads.\n");
+		sws_slices_stop ();
+		for (; i < n; ++i) {
+			sws_freeContext (sws_slice[i].ctx);
+			sws_slice[i].ctx = NULL;
+		}
+	}
+}
+
+static void sws_convert_sliced (uint8_t * const *src, const int *srcStride, uint8_t * const *dst) {
+	pthread_mutex_lock (&sws_pool_lock);
+	sws_job_src = src;
+	sws_job_stride = srcStride;
+	sws_job_dst = dst;
+	sws_pool_pending = sws_nslices - 1;
+	++sws_pool_job;
+	pthread_cond_broadcast (&sws_pool_wake);
+	pthread_mutex_unlock (&sws_pool_lock);
+
+	sws_convert_slice (0);
+
+	pthread_mutex_lock (&sws_pool_lock);
+	while (sws_pool_pending > 0) {
+		pthread_cond_wait (&sws_pool_done, &sws_pool_lock);
+	}
+	pthread_mutex_unlock (&sws_pool_lock);
+}
+
+#else
+
+static const int sws_nslices = 0;
+static void sws_slices_stop (void) { ; }
+static void sws_slices_start (int src_w, int src_h, int src_fmt) { ; }
+static void sws_convert_sliced (uint8_t * const *src, const int *srcStride, uint8_t * const *dst) { ; }
+
+#endif
+
+/* pick the conversion path between decoder output and render_fmt */
+static void negotiate_conversion (void) {
+	render_fmt_stride (render_stride);
+	render_copy = pCodecCtx->pix_fmt == render_fmt
+		&& pCodecCtx->width == movie_width
+		&& pCodecCtx->height == movie_height;
+	if (render_copy) {
+		pSWSCtx = NULL;
+	} else {
+		pSWSCtx = sws_cache_get (pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt,
+				movie_width, movie_height, render_fmt, SWS_BICUBIC);
+	}
+	if (render_copy) {
+		sws_slices_stop ();
+	} else {
+		sws_slices_start (pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt);
+	}
+	conv_frames = conv_total = conv_peak = conv_last = 0;
+	if (want_verbose) {
+		if (sws_nslices > 1) {
+			printf("video conversion: swscale, %d slices\n", sws_nslices);
+		} else {
+			printf("video conversion: %s\n", render_copy ? "plane copy" : "swscale");
+		}
+	}
+}
+
+//--------------------------------------------
+// pristine frame
+//--------------------------------------------
+
+/* The OSD is rendered into `buffer`. To redraw the OSD on top of
+ * the same video frame (forced redraws) the converted frame is
+ * restored from the frame cache, or - if the cache is disabled -
+ * from a private copy, instead of decoding and converting it again.
+ */
+static uint8_t *pristine = NULL;
+static int64_t  pristine_frame = -1;
+
+static uint64_t redraws_recomposited = 0;
+static uint64_t redraws_skipped = 0;
+
+static void pristine_reset (void) {
+	free (pristine);
+	pristine = NULL;
+	pristine_frame = -1;
+}
+
+/* remember the converted frame currently in `buffer` */
+static void pristine_put (int64_t frame) {
+	pristine_frame = frame;
+	if (fcache_size > 0) {
+		free (pristine);
+		pristine = NULL;
+		return;
+	}
+	if (!pristine) {
+		pristine = malloc (vbufsize);
+	}
+	if (pristine) {
+		memcpy (pristine, buffer, vbufsize);
+	} else {
+		pristine_frame = -1;
+	}
+}
+
+static int pristine_get (int64_t frame, uint8_t *dst) {
+	if (frame != pristine_frame) return -1;
+	if (pristine) {
+		memcpy (dst, pristine, vbufsize);
+		return 0;
+	}
+	return frame_cache_peek (frame, dst);
+}
+
+void redraw_stats (uint64_t *recomposited, uint64_t *skipped) {
+	if (recomposited) *recomposited = redraws_recomposited;
+	if (skipped)      *skipped      = redraws_skipped;
+}
+
+static void readahead_start (void);
+
 void init_moviebuffer (void) {
-	if (buffer) free (buffer);
+	readahead_stop ();
+	free (moviebuffer);
 	if (want_debug)
 		printf("DEBUG: init_moviebuffer - render_fmt: %i\n",render_fmt);
 	/* Determine required buffer size and allocate buffer */
@@ -437,14 +1287,19 @@ void init_moviebuffer (void) {
 #else
 	vbufsize = avpicture_get_size (render_fmt, movie_width, movie_height);
 #endif
-	buffer = (uint8_t *)calloc (1, vbufsize);
+	buffer = moviebuffer = (uint8_t *)calloc (1, vbufsize);
+	pristine_reset ();
 
 	// Assign appropriate parts of buffer to image planes in pFrameFMT
 	if (pFrameFMT) {
 		avpicture_fill ((AVPicture *)pFrameFMT, buffer, render_fmt, movie_width, movie_height);
-		pSWSCtx = sws_getContext (pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt, movie_width, movie_height, render_fmt, SWS_BICUBIC, NULL, NULL, NULL);
+		negotiate_conversion ();
 	}
+	frame_cache_init ();
 	render_empty_frame (0, 0);
+	if (pFrameFMT) {
+		readahead_start ();
+	}
 }
 
 void avinit (void) {
@@ -464,6 +1319,12 @@ static void reset_index () {
 	abort_indexing = 0;
 	scan_complete = 0;
 	byte_seek = 0;
+	decoder_delay = 0;
+	idx_priority = -1;
+	kfcnt = 0;
+	idx_direct = 0;
+	idx_first_pts = -1;
+	idx_ts_offset = 0;
 }
 
 static uint64_t parse_pts_from_frame (AVFrame *f) {
@@ -514,19 +1375,28 @@ static uint64_t parse_pts_from_frame (AVFrame *f) {
 	return pts;
 }
 
+static void flush_decoder (void) {
+	/* with frame-threading, the thread-pool needs to be flushed,
+	 * even if the codec itself has no flush callback. */
+	if (pCodecCtx->codec->flush || decoder_delay > 0) {
+		avcodec_flush_buffers (pCodecCtx);
+	}
+}
+
 static int seek_frame (AVPacket *packet, int64_t framenumber) {
-	if (!scan_complete) return -1;
 	if (videoStream < 0) return -1;
 
 	if (want_ignstart) {
 		framenumber += file_frame_offset;
 	}
 
+	if (!index_ready (framenumber)) return -1;
+
 	if (framenumber < 0 || framenumber >= fcnt) {
 		return -1;
 	}
 
-	const int64_t timestamp = fidx[framenumber].timestamp;
+	const int64_t timestamp = frame_timestamp (framenumber);
 
 	if (timestamp < 0 || framenumber >= frames) {
 		return -1;
@@ -547,7 +1417,7 @@ static int seek_frame (AVPacket *packet, int64_t framenumber) {
 		need_seek = 1;
 	} else if ((framenumber - last_decoded_frameno) == 1) {
 		; // don't seek for consecutive frames
-	} else if (fidx[framenumber].seekpts != fidx[last_decoded_frameno].seekpts) {
+	} else if (seek_entry (framenumber) != seek_entry (last_decoded_frameno)) {
 		need_seek = 1;
 	}
 
@@ -556,21 +1426,19 @@ static int seek_frame (AVPacket *packet, int64_t framenumber) {
 
 	if (need_seek) {
 		int seek;
-		if (byte_seek && fidx[framenumber].seekpos > 0) {
+		if (byte_seek && seek_pos (framenumber) > 0) {
 #if 0 // DEBUG
-			printf("Seek to POS: %"PRId64"\n", fidx[framenumber].seekpos);
+			printf("Seek to POS: %"PRId64"\n", seek_pos (framenumber));
 #endif
-			seek = av_seek_frame (pFormatCtx, videoStream, fidx[framenumber].seekpos, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE);
+			seek = av_seek_frame (pFormatCtx, videoStream, seek_pos (framenumber), AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE);
 		} else {
 #if 0 // DEBUG
-			printf("Seek to PTS: %"PRId64"\n", fidx[framenumber].seekpts);
+			printf("Seek to PTS: %"PRId64"\n", seek_pts (framenumber));
 #endif
-			seek = av_seek_frame (pFormatCtx, videoStream, fidx[framenumber].seekpts, AVSEEK_FLAG_BACKWARD);
+			seek = av_seek_frame (pFormatCtx, videoStream, seek_pts (framenumber), AVSEEK_FLAG_BACKWARD);
 		}
 
-		if (pCodecCtx->codec->flush) {
-			avcodec_flush_buffers (pCodecCtx);
-		}
+		flush_decoder ();
 
 		if (seek < 0) {
 			if (!want_quiet)
@@ -579,7 +1447,7 @@ static int seek_frame (AVPacket *packet, int64_t framenumber) {
 		}
 	}
 
-	int bailout = 2 * seek_threshold;
+	int bailout = 2 * seek_threshold + decoder_delay;
 	while (bailout > 0) {
 		int err;
 		if ((err = av_read_frame (pFormatCtx, packet)) < 0) {
@@ -589,6 +1457,10 @@ static int seek_frame (AVPacket *packet, int64_t framenumber) {
 				av_free_packet (packet);
 				return -1;
 			} else {
+				// feed an empty packet to drain delayed frames
+				packet->data = NULL;
+				packet->size = 0;
+				packet->stream_index = videoStream;
 				--bailout;
 			}
 		}
@@ -670,70 +1542,951 @@ static int seek_frame (AVPacket *packet, int64_t framenumber) {
 					timestamp, pts, key ? "Y" : "N");
 		}
 #endif
-
-		--bailout;
+
+		--bailout;
+	}
+
+	if (!want_quiet)
+		fprintf(stderr, "Index-seek: bail out. frame-distance too large.\n");
+	return -5;
+}
+
+/* the decoder (pFormatCtx, pCodecCtx, pFrame, pSWSCtx and the
+ * last_decoded_* seek state) is shared by display_frame() and the
+ * read-ahead thread.
+ */
+static pthread_mutex_t decoder_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* seek to the given frame, decode it and convert it to render_fmt */
+static int decode_frame (AVPacket *packet, int64_t framenumber, uint8_t * const *dst) {
+	int rv;
+	pthread_mutex_lock (&decoder_lock);
+	rv = seek_frame (packet, framenumber);
+	if (!rv) {
+		const int64_t t0 = xj_get_monotonic_time ();
+		if (render_copy) {
+			copy_frame_planes (dst);
+		} else if (sws_nslices > 1) {
+			sws_convert_sliced (pFrame->data, pFrame->linesize, dst);
+		} else if (pSWSCtx) {
+			sws_scale (pSWSCtx, (const uint8_t * const*)pFrame->data, pFrame->linesize, 0, pCodecCtx->height, dst, render_stride);
+		}
+		conv_last = xj_get_monotonic_time () - t0;
+		conv_total += conv_last;
+		conv_peak = MAX(conv_peak, conv_last);
+		++conv_frames;
+	} else {
+		last_decoded_pts = -1;
+		last_decoded_frameno = -1;
+	}
+	pthread_mutex_unlock (&decoder_lock);
+	return rv;
+}
+
+/* per-frame conversion time in microseconds */
+void conversion_stats (uint64_t *frames, int64_t *last, int64_t *avg, int64_t *peak, int *slices) {
+	pthread_mutex_lock (&decoder_lock);
+	if (frames) *frames = conv_frames;
+	if (last)   *last   = conv_last;
+	if (avg)    *avg    = conv_frames > 0 ? conv_total / (int64_t)conv_frames : 0;
+	if (peak)   *peak   = conv_peak;
+	if (slices) *slices = render_copy ? 0 : MAX(1, sws_nslices);
+	pthread_mutex_unlock (&decoder_lock);
+}
+
+//--------------------------------------------
+// read-ahead decoder thread
+//--------------------------------------------
+
+/* The event-loop predicts upcoming frames from the sync-source
+ * history and the read-ahead thread decodes them into the frame
+ * cache, so that display_frame() only needs to copy and blit them.
+ */
+static pthread_t       readahead_thread;
+static pthread_mutex_t readahead_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  readahead_cond = PTHREAD_COND_INITIALIZER;
+static uint8_t  readahead_active = 0;
+static uint8_t  readahead_abort  = 0;
+static int64_t  readahead_next   = -1; ///< first predicted frame
+static int      readahead_step   = 0;  ///< frames per video-frame, 0: idle
+static uint32_t readahead_serial = 0;  ///< incremented on every new prediction
+
+static int readahead_cancelled (uint32_t serial) {
+	int rv;
+	pthread_mutex_lock (&readahead_lock);
+	rv = readahead_abort || serial != readahead_serial;
+	pthread_mutex_unlock (&readahead_lock);
+	return rv;
+}
+
+static void *readahead_run (void *arg) {
+	AVPacket packet;
+	AVPicture pic;
+	uint8_t *rabuf;
+	uint32_t serial = 0;
+
+#ifndef HAVE_AV_INIT_PACKET
+	memset (&packet, 0, sizeof(AVPacket));
+#else
+	av_init_packet (&packet);
+#endif
+	packet.data = NULL;
+	packet.size = 0;
+
+	rabuf = (uint8_t *)malloc (vbufsize);
+	if (!rabuf) {
+		pthread_exit (NULL);
+		return (NULL);
+	}
+	avpicture_fill (&pic, rabuf, render_fmt, movie_width, movie_height);
+
+	pthread_mutex_lock (&readahead_lock);
+	while (!readahead_abort) {
+		if (serial == readahead_serial) {
+			pthread_cond_wait (&readahead_cond, &readahead_lock);
+			continue;
+		}
+		serial = readahead_serial;
+		int64_t fn = readahead_next;
+		const int step = readahead_step;
+		// don't let read-ahead evict the frames it is about to display
+		const int count = MIN(readahead_frames, fcache_size / 2);
+		const int64_t last = frames;
+		pthread_mutex_unlock (&readahead_lock);
+
+		int i;
+		for (i = 0; i < count && step != 0; ++i, fn += step) {
+			if (readahead_cancelled (serial)) break;
+			if (fn < 0 || fn >= last) break;
+			if (!index_ready (want_ignstart ? fn + file_frame_offset : fn)) break;
+			if (frame_cache_has (fn)) continue;
+			if (decode_frame (&packet, fn, pic.data)) break;
+			frame_cache_put (fn, rabuf);
+		}
+
+		pthread_mutex_lock (&readahead_lock);
+	}
+	pthread_mutex_unlock (&readahead_lock);
+
+	free (rabuf);
+	pthread_exit (NULL);
+	return (NULL);
+}
+
+static void readahead_start (void) {
+	if (readahead_active) return;
+	if (readahead_frames <= 0 || fcache_size < 4) return;
+	readahead_abort  = 0;
+	readahead_next   = -1;
+	readahead_step   = 0;
+	readahead_serial = 0;
+	if (pthread_create (&readahead_thread, NULL, readahead_run, NULL)) {
+		if (!want_quiet) fprintf(stderr, "Cannot launch read-ahead thread.\n");
+		return;
+	}
+	readahead_active = 1;
+}
+
+static void readahead_stop (void) {
+	if (!readahead_active) return;
+	pthread_mutex_lock (&readahead_lock);
+	readahead_abort = 1;
+	pthread_cond_signal (&readahead_cond);
+	pthread_mutex_unlock (&readahead_lock);
+	pthread_join (readahead_thread, NULL);
+	readahead_active = 0;
+}
+
+static void readahead_predict (int64_t frame, uint8_t stopped) {
+	static int64_t prev_frame = -1;
+	static int64_t prev_change = 0;
+	static int     step = 1;
+	const int64_t  now = xj_get_monotonic_time ();
+
+	if (!readahead_active) return;
+
+	if (frame != prev_frame) {
+		const int64_t delta = frame - prev_frame;
+		if (prev_frame >= 0 && delta != 0 && delta >= -4 && delta <= 4) {
+			step = delta;
+		}
+		// else: discontinuity (locate), keep direction
+		prev_frame = frame;
+		prev_change = now;
+	}
+
+	/* no change for more than two video-frames: parked */
+	const double fps = framerate > 0 ? framerate : 25;
+	if (stopped || (now - prev_change) > 2e6 / fps) {
+		return;
+	}
+
+	pthread_mutex_lock (&readahead_lock);
+	if (readahead_next != frame + step || readahead_step != step) {
+		readahead_next = frame + step;
+		readahead_step = step;
+		++readahead_serial;
+		pthread_cond_signal (&readahead_cond);
+	}
+	pthread_mutex_unlock (&readahead_lock);
+}
+
+float index_progress = 0;
+
+static void report_idx_progress (const char *msg, float percent) {
+	static int lastval = 0;
+	if (!(OSD_mode & OSD_MSG)) return;
+	if (floorf (percent) == lastval) return; // also check msg?
+	lastval = floorf (percent);
+	index_progress = percent;
+	sprintf(OSD_msg, "%s%3.0f%%", msg, percent);
+	force_redraw = 1;
+}
+
+static int add_idx (int64_t ts, int64_t pos, uint8_t key, int _duration, AVRational tb) {
+	if (fcnt >= frames) {
+		if (!want_quiet)
+			fprintf(stderr, "Index table Overflow: %"PRId64" / %"PRId64" frames.\n", fcnt + 1, frames);
+		return -1;
+	}
+	report_idx_progress ("Pass 1: Scanning File:", 100.f * fcnt / frames);
+
+	if (fcnt == 0) {
+		idx_first_pts = ts;
+	}
+	if (key) {
+		struct KeyframeIndex *kf = kf_add (fcnt);
+		if (!kf) {
+			return -1;
+		}
+		kf->pkt_pts = ts;
+		kf->pkt_pos = pos;
+	}
+	fidx[fcnt] = -1;
+#if 0 // DEBUG
+	if (fcnt < 50 || key)
+	printf("IDX %"PRId64" PKT-PTS %"PRId64"  TS %"PRId64"\n", fcnt, ts, frame_timestamp (fcnt));
+#endif
+	++fcnt;
+	return 0;
+}
+
+/* The index is built progressively: pass 1 reads packets sequentially
+ * and publishes them in chunks of IDX2_CHUNK frames. Worker threads
+ * (each with its own format- and codec-context) verify the keyframes
+ * of every chunk (pass 2), preferring the region around the frame that
+ * is currently requested by the display. Once all keyframes a chunk may
+ * refer to are verified, its seek-table entries are assigned (pass 3)
+ * and the frames of the chunk can be displayed, before the scan is
+ * complete.
+ */
+
+#define IDX2_MAX_WORKERS (16)
+#define IDX2_PRIORITY_WINDOW (64) ///< chunks around the requested frame
+
+struct IndexWorker {
+	pthread_t        thread;
+	AVFormatContext *fmt;
+	AVCodecContext  *codec;
+	AVFrame         *frame;
+	int              own;
+	int              error;
+	int64_t          keyframes;
+};
+
+static pthread_mutex_t idx2_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  idx2_cond = PTHREAD_COND_INITIALIZER;
+static struct IndexWorker idx2_worker[IDX2_MAX_WORKERS];
+static int     idx2_nworkers = 0;
+static int64_t idx1_cnt = 0;   ///< frames published by pass 1
+static uint8_t idx1_done = 0;
+static int     idx1_max_kfi = 0;
+static int64_t idx2_next = 0;  ///< lowest chunk which may still be pending
+static int64_t idx2_done = 0;  ///< number of verified chunks
+static uint8_t idx2_stop = 0;
+static int     idx2_error = 0;
+static int64_t idx3_usec = 0;   ///< time spent in idx3_finalize_chunk()
+static int64_t idx3_calls = 0;
+static int64_t idx3_chunks = 0; ///< number of finalized chunks
+
+static int idx2_worker_open (struct IndexWorker *w, const char *movie, const int slice_threads) {
+	AVCodec *codec;
+	memset (w, 0, sizeof (struct IndexWorker));
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(53, 7, 0)
+	if (av_open_input_file (&w->fmt, movie, NULL, 0, NULL) != 0)
+#else
+	if (avformat_open_input (&w->fmt, movie, NULL, NULL) != 0)
+#endif
+	{
+		w->fmt = NULL;
+		return -1;
+	}
+	if (avformat_find_stream_info (w->fmt, NULL) < 0
+			|| w->fmt->nb_streams <= videoStream
+			|| w->fmt->streams[videoStream]->codec->codec_type != AVMEDIA_TYPE_VIDEO)
+	{
+		goto fail;
+	}
+#ifdef AVFMT_FLAG_GENPTS
+	if (want_genpts)
+		w->fmt->flags |= AVFMT_FLAG_GENPTS;
+#endif
+
+	w->codec = w->fmt->streams[videoStream]->codec;
+	codec = avcodec_find_decoder (w->codec->codec_id);
+	if (!codec) {
+		goto fail;
+	}
+#ifdef FF_THREAD_FRAME
+	// parallelism comes from the workers, slice-threads
+	// (if requested) do not add decoder delay.
+	w->codec->thread_count = slice_threads ? decoder_threads : 1;
+	w->codec->thread_type = FF_THREAD_SLICE;
+#endif
+	if (avcodec_open2 (w->codec, codec, NULL) < 0) {
+		goto fail;
+	}
+	if (!(w->frame = av_frame_alloc())) {
+		avcodec_close (w->codec);
+		goto fail;
+	}
+	w->own = 1;
+	return 0;
+
+fail:
+	avformat_close_input (&w->fmt);
+	w->fmt = NULL;
+	w->codec = NULL;
+	return -1;
+}
+
+static void idx2_worker_close (struct IndexWorker *w) {
+	if (!w->own) return;
+	av_free (w->frame);
+	avcodec_close (w->codec);
+	avformat_close_input (&w->fmt);
+	w->own = 0;
+}
+
+static int idx2_verify_keyframe (struct IndexWorker *w, const int64_t k) {
+	struct KeyframeIndex *kf = KF(k);
+	AVPacket packet;
+	int got_pic = 0;
+	int64_t pts = AV_NOPTS_VALUE;
+
+#ifndef HAVE_AV_INIT_PACKET
+	memset (&packet, 0, sizeof(AVPacket));
+#else
+	av_init_packet (&packet);
+#endif
+	packet.data = NULL;
+	packet.size = 0;
+
+	if (av_seek_frame (w->fmt, videoStream, kf->pkt_pts, AVSEEK_FLAG_BACKWARD)) {
+		fprintf(stderr, "IDX2: Seek failed.\n");
+		return 16;
+	}
+	if (w->codec->codec->flush) {
+		avcodec_flush_buffers (w->codec);
+	}
+
+	int err = 0;
+	int bailout = 100;
+	while (!got_pic && --bailout) {
+
+		if ((err = av_read_frame (w->fmt, &packet)) < 0) {
+			if (err == AVERROR_EOF) {
+				fprintf(stderr, "IDX2: Read/Seek compensate for premature EOF\n");
+				// not a usable keyframe
+				kf->frame_pts = AV_NOPTS_VALUE;
+				av_free_packet (&packet);
+				return 0;
+			}
+			fprintf(stderr, "IDX2: Read failed @ %"PRId64" / %"PRId64".\n", kf->frame, fcnt);
+			return 32;
+		}
+
+#ifdef USE_DUP_PACKET
+		if (av_dup_packet (&packet) < 0) {
+			if (!want_quiet)
+				fprintf(stderr, "Error: Cannot allocate video packet.\n");
+			break;
+		}
+#endif
+		if (packet.stream_index==videoStream) {
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(52, 21, 0)
+			err = avcodec_decode_video (w->codec, w->frame, &got_pic, packet.data, packet.size);
+#else
+			err = avcodec_decode_video2 (w->codec, w->frame, &got_pic, &packet);
+#endif
+		}
+		av_free_packet (&packet);
+
+		if (err < 0) {
+			break;
+		}
+
+		if (!got_pic) {
+			continue;
+		}
+
+		pts = parse_pts_from_frame (w->frame);
+
+		if (pts == AV_NOPTS_VALUE) {
+			err = -1;
+			if (!want_quiet)
+				fprintf(stderr, "No presentation timestamp (PTS) for video frame.\n");
+			break;
+		}
+	}
+
+	if (err < 0 || !bailout) return 0;
+
+	kf->frame_pts = pts;
+	kf->frame_pos = av_frame_get_pkt_pos (w->frame);
+	if (pts != AV_NOPTS_VALUE) {
+#if 0 // DEBUG
+		printf("FN %"PRId64", PKT-PTS %"PRId64" FRM-PTS: %"PRId64"\n", kf->frame, kf->pkt_pts, kf->frame_pts);
+#endif
+		++w->keyframes;
+	}
+	return 0;
+}
+
+/* find the keyframe to seek to for a frame with the given timestamp,
+ * searching backwards from keyframe 'kl'.
+ * returns -1 if an unverified keyframe is in the way.
+ */
+static int keyframe_lookup_helper (const int64_t kl, const int64_t ts, int64_t *kfi) {
+	int64_t k;
+	assert(kl < kfcnt);
+	for (k = kl; k >= 0; --k) {
+		const struct KeyframeIndex *kf = KF(k);
+		if (idx_chunk[kf->frame / IDX2_CHUNK] < IDX_CHUNK_VERIFIED) {
+			return -1;
+		}
+		if (kf->pkt_pts == AV_NOPTS_VALUE || kf->frame_pts == AV_NOPTS_VALUE) {
+			continue;
+		}
+		if (kf->frame_pts <= ts) {
+			*kfi = k;
+			return 0;
+		}
+	}
+	*kfi = -1;
+	return 0;
+}
+
+/* pass 3 for one chunk: assign a seek-[key]frame to every frame.
+ * must be called with idx2_lock held.
+ */
+static int idx3_fill_chunk (const int64_t c) {
+	const int64_t avail = idx1_done ? fcnt : idx1_cnt;
+	const int64_t first = c * IDX2_CHUNK;
+	const int64_t end = MIN(avail, first + IDX2_CHUNK);
+	int64_t i;
+
+	if (idx_chunk[c] != IDX_CHUNK_VERIFIED) {
+		return -1;
+	}
+
+	// keyframes following the chunk may be used for reordered frames
+	int64_t last = end - 1 + 2 + idx1_max_kfi;
+	if (last >= avail) {
+		if (!idx1_done) return -1;
+		last = avail - 1;
+	}
+	for (i = c + 1; i <= last / IDX2_CHUNK; ++i) {
+		if (idx_chunk[i] < IDX_CHUNK_VERIFIED) return -1;
+	}
+
+	/* single forward sweep: 'kl' is the last keyframe within the
+	 * look-ahead of frame i, the backward search from there only
+	 * visits the few keyframes inside the look-ahead window. */
+	int64_t kl = kf_find (MIN(avail - 1, first + 2 + idx1_max_kfi));
+	for (i = first; i < end; ++i) {
+		int64_t kfi;
+		const int64_t la = MIN(avail - 1, i + 2 + idx1_max_kfi);
+		while (kl + 1 < kf_count () && KF(kl + 1)->frame <= la) {
+			++kl;
+		}
+		if (keyframe_lookup_helper (kl, frame_timestamp (i), &kfi)) {
+			return -1;
+		}
+		if (kfi < 0 && !want_quiet) {
+			fprintf(stderr, "Cannot find keyframe for %"PRId64" %"PRId64"\n", i, frame_timestamp (i));
+		}
+		//fprintf(stderr, "using keyframe %"PRId64" for %"PRId64"\n", kfi, frame_timestamp (i));
+		fidx[i] = kfi;
+	}
+	idx_chunk_publish (c);
+	force_redraw = 1;
+	++idx3_chunks;
+	return 0;
+}
+
+/* timed wrapper of idx3_fill_chunk(), reported with --verbose */
+static int idx3_finalize_chunk (const int64_t c) {
+	const int64_t t0 = xj_get_monotonic_time ();
+	const int rv = idx3_fill_chunk (c);
+	idx3_usec += xj_get_monotonic_time () - t0;
+	++idx3_calls;
+	return rv;
+}
+
+/* must be called with idx2_lock held */
+static int64_t idx2_pick_chunk (void) {
+	const int64_t avail = idx1_done ? idx_nchunks : idx1_cnt / IDX2_CHUNK;
+	if (avail <= 0) {
+		return -1;
+	}
+	if (idx_priority >= 0) {
+		const int64_t pc = MIN(avail - 1, idx_priority / IDX2_CHUNK);
+		int64_t d;
+		for (d = 0; d < IDX2_PRIORITY_WINDOW; ++d) {
+			if (pc + d < avail && idx_chunk[pc + d] == IDX_CHUNK_PENDING) {
+				return pc + d;
+			}
+			if (d > 0 && pc - d >= 0 && idx_chunk[pc - d] == IDX_CHUNK_PENDING) {
+				return pc - d;
+			}
+		}
+	}
+	while (idx2_next < avail && idx_chunk[idx2_next] != IDX_CHUNK_PENDING) {
+		++idx2_next;
+	}
+	return idx2_next < avail ? idx2_next : -1;
+}
+
+static void *idx2_worker_run (void *arg) {
+	struct IndexWorker *w = (struct IndexWorker *)arg;
+	pthread_mutex_lock (&idx2_lock);
+	while (!idx2_stop && !idx2_error && !abort_indexing) {
+		int64_t i, k, c, end;
+		if ((c = idx2_pick_chunk ()) < 0) {
+			if (idx1_done) break;
+			pthread_cond_wait (&idx2_cond, &idx2_lock);
+			continue;
+		}
+		idx_chunk[c] = IDX_CHUNK_BUSY;
+		i   = c * IDX2_CHUNK;
+		end = MIN(idx1_done ? fcnt : idx1_cnt, i + IDX2_CHUNK);
+		pthread_mutex_unlock (&idx2_lock);
+
+		for (k = kf_find (i - 1) + 1; k < kf_count () && KF(k)->frame < end && !abort_indexing; ++k) {
+			if ((w->error = idx2_verify_keyframe (w, k))) {
+				break;
+			}
+		}
+
+		pthread_mutex_lock (&idx2_lock);
+		if (w->error || abort_indexing) {
+			idx_chunk[c] = IDX_CHUNK_PENDING;
+			idx2_error |= w->error;
+			break;
+		}
+		idx_chunk[c] = IDX_CHUNK_VERIFIED;
+		++idx2_done;
+		if (idx1_done) {
+			report_idx_progress ("Pass 2: Indexing Frames:", 100.f * idx2_done / idx_nchunks);
+		}
+		/* this chunk, as well as its neighbors may now be complete */
+		const int64_t span = 2 + (2 + idx1_max_kfi) / IDX2_CHUNK;
+		for (i = MAX(0, c - span); i <= c + span && i < idx_nchunks; ++i) {
+			idx3_finalize_chunk (i);
+		}
+	}
+	pthread_mutex_unlock (&idx2_lock);
+	return NULL;
+}
+
+static void idx2_start (const char *movie) {
+	int n = index_threads > 0 ? index_threads : av_cpu_count ();
+	n = MAX(1, MIN(IDX2_MAX_WORKERS, MIN(n, idx_nchunks)));
+
+	idx1_cnt = 0;
+	idx1_done = 0;
+	idx1_max_kfi = 0;
+	idx2_next = 0;
+	idx2_done = 0;
+	idx2_stop = 0;
+	idx2_error = 0;
+	memset (idx_chunk, IDX_CHUNK_PENDING, idx_nchunks);
+
+	for (idx2_nworkers = 0; idx2_nworkers < n; ++idx2_nworkers) {
+		struct IndexWorker *w = &idx2_worker[idx2_nworkers];
+		if (idx2_worker_open (w, movie, 0)) {
+			break;
+		}
+		if (pthread_create (&w->thread, NULL, idx2_worker_run, w)) {
+			idx2_worker_close (w);
+			break;
+		}
+	}
+	if (want_verbose)
+		printf("Verifying keyframes using %d thread%s\n",
+				idx2_nworkers, idx2_nworkers != 1 ? "s" : "");
+}
+
+static int64_t idx2_join (void) {
+	int64_t keyframes = 0;
+	int w;
+	for (w = 0; w < idx2_nworkers; ++w) {
+		pthread_join (idx2_worker[w].thread, NULL);
+		idx2_worker_close (&idx2_worker[w]);
+		keyframes += idx2_worker[w].keyframes;
+	}
+	idx2_nworkers = 0;
+	return keyframes;
+}
+
+static void idx2_stop_workers (void) {
+	pthread_mutex_lock (&idx2_lock);
+	idx2_stop = 1;
+	pthread_cond_broadcast (&idx2_cond);
+	pthread_mutex_unlock (&idx2_lock);
+	idx2_join ();
+}
+
+/* hand frames [0, cnt) to pass 2. With inline verification, chunks
+ * whose keyframes were all decoded during pass 1 are complete,
+ * the others are left to the workers.
+ */
+static void idx1_publish (const int64_t cnt, const int max_kfi, const uint8_t done, const uint8_t *inline_fail) {
+	int64_t c;
+	const int64_t c0 = idx1_cnt / IDX2_CHUNK;
+	const int64_t c1 = done ? (cnt + IDX2_CHUNK - 1) / IDX2_CHUNK : cnt / IDX2_CHUNK;
+
+	pthread_mutex_lock (&idx2_lock);
+	idx1_cnt = cnt;
+	idx1_max_kfi = max_kfi;
+	seek_threshold = MAX(2, max_kfi - 1);
+	if (done) {
+		// chunks past the end of the file, in case the estimate was too large
+		for (c = c1; c < idx_nchunks; ++c) {
+			idx_chunk_publish (c);
+		}
+		idx1_done = 1;
+	}
+	if (inline_fail) {
+		const int64_t span = 2 + (2 + max_kfi) / IDX2_CHUNK;
+		for (c = c0; c < c1; ++c) {
+			if (idx_chunk[c] == IDX_CHUNK_PENDING && !inline_fail[c]) {
+				idx_chunk[c] = IDX_CHUNK_VERIFIED;
+				++idx2_done;
+			}
+		}
+		for (c = MAX(0, c0 - span); c < c1; ++c) {
+			idx3_finalize_chunk (c);
+		}
+	}
+	pthread_cond_broadcast (&idx2_cond);
+	pthread_mutex_unlock (&idx2_lock);
+}
+
+/* seek-free keyframe verification: during pass 1 keyframe packets
+ * are decoded by the indexer's own codec-context (which skips
+ * non-keyframes), so the frame PTS is known without random I/O.
+ * Keyframes which cannot be matched to a decoded frame are flagged
+ * and their chunk is verified by seeking (pass 2) instead.
+ */
+
+#define IDX1_INLINE_QUEUE (64)
+
+static int64_t  idx1_kq[IDX1_INLINE_QUEUE]; ///< keyframes (kfidx) in the decoder
+static int      idx1_kq_head = 0;
+static int      idx1_kq_len = 0;
+static int64_t  idx1_inline_keyframes = 0;
+static uint8_t *idx1_inline_fail = NULL; ///< per chunk
+
+static void idx1_inline_pop (const uint8_t failed) {
+	const int64_t k = idx1_kq[idx1_kq_head];
+	if (failed) {
+		idx1_inline_fail[KF(k)->frame / IDX2_CHUNK] = 1;
+	}
+	idx1_kq_head = (idx1_kq_head + 1) % IDX1_INLINE_QUEUE;
+	--idx1_kq_len;
+}
+
+static void idx1_inline_output (struct IndexWorker *w) {
+	const int64_t pts = parse_pts_from_frame (w->frame);
+	const int64_t pos = av_frame_get_pkt_pos (w->frame);
+	int n;
+
+	// keyframes are decoded in order, those before the match produced no frame
+	for (n = 0; n < idx1_kq_len; ++n) {
+		const struct KeyframeIndex *kf = KF(idx1_kq[(idx1_kq_head + n) % IDX1_INLINE_QUEUE]);
+		if (pos < 0 || kf->pkt_pos < 0 || kf->pkt_pos == pos) {
+			break;
+		}
+	}
+	if (n == idx1_kq_len) {
+		return;
+	}
+	while (n-- > 0) {
+		idx1_inline_pop (1);
+	}
+
+	struct KeyframeIndex *kf = KF(idx1_kq[idx1_kq_head]);
+	if (pts == AV_NOPTS_VALUE) {
+		idx1_inline_pop (1);
+		return;
+	}
+	kf->frame_pts = pts;
+	kf->frame_pos = pos;
+	++idx1_inline_keyframes;
+	idx1_inline_pop (0);
+}
+
+static void idx1_inline_decode (struct IndexWorker *w, AVPacket *packet, const int64_t k) {
+	int got_pic = 0;
+	int err;
+	if (idx1_kq_len == IDX1_INLINE_QUEUE) {
+		idx1_inline_pop (1);
+	}
+	idx1_kq[(idx1_kq_head + idx1_kq_len) % IDX1_INLINE_QUEUE] = k;
+	++idx1_kq_len;
+
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(52, 21, 0)
+	err = avcodec_decode_video (w->codec, w->frame, &got_pic, packet->data, packet->size);
+#else
+	err = avcodec_decode_video2 (w->codec, w->frame, &got_pic, packet);
+#endif
+	if (err >= 0 && got_pic) {
+		idx1_inline_output (w);
+	}
+}
+
+static void idx1_inline_drain (struct IndexWorker *w) {
+	AVPacket packet;
+#ifndef HAVE_AV_INIT_PACKET
+	memset (&packet, 0, sizeof(AVPacket));
+#else
+	av_init_packet (&packet);
+#endif
+	packet.data = NULL;
+	packet.size = 0;
+
+	while (idx1_kq_len > 0) {
+		int got_pic = 0;
+		int err;
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(52, 21, 0)
+		err = avcodec_decode_video (w->codec, w->frame, &got_pic, NULL, 0);
+#else
+		err = avcodec_decode_video2 (w->codec, w->frame, &got_pic, &packet);
+#endif
+		if (err < 0 || !got_pic) {
+			break;
+		}
+		idx1_inline_output (w);
+	}
+	while (idx1_kq_len > 0) {
+		idx1_inline_pop (1);
+	}
+}
+
+/* frames before the oldest keyframe still in the decoder are resolved */
+static int64_t idx1_inline_resolved (void) {
+	return idx1_kq_len > 0 ? KF(idx1_kq[idx1_kq_head])->frame : fcnt;
+}
+
+/* instant index: containers like MOV/MP4 carry a complete sample
+ * table. If the demuxer's index has an entry for every frame, the index
+ * is built from it, without reading the file. Index entries only
+ * provide the DTS, the offset to the keyframe's PTS is measured by
+ * decoding a few keyframes, and a random sample of frames is checked
+ * by seeking to them. If any check fails, the file is scanned.
+ */
+
+#define IDX0_SAMPLES (8)
+
+/* seek to frame i using the seek-entry of the index and
+ * check that the frame can be reached. */
+static int idx0_check_frame (struct IndexWorker *w, const int64_t i, const int max_kfi) {
+	AVPacket packet;
+	int64_t kfi;
+	int bailout = 2 * max_kfi + 100;
+
+	const int64_t timestamp = frame_timestamp (i);
+	if (keyframe_lookup_helper (kf_find (MIN(fcnt - 1, i + 2 + max_kfi)), timestamp, &kfi) || kfi < 0) {
+		return -1;
+	}
+
+#ifndef HAVE_AV_INIT_PACKET
+	memset (&packet, 0, sizeof(AVPacket));
+#else
+	av_init_packet (&packet);
+#endif
+	packet.data = NULL;
+	packet.size = 0;
+
+	if (av_seek_frame (w->fmt, videoStream, KF(kfi)->pkt_pts, AVSEEK_FLAG_BACKWARD) < 0) {
+		return -1;
+	}
+	if (w->codec->codec->flush) {
+		avcodec_flush_buffers (w->codec);
+	}
+
+	while (--bailout > 0) {
+		int got_pic = 0;
+		int err = 0;
+		if (av_read_frame (w->fmt, &packet) < 0) {
+			av_free_packet (&packet);
+			return -1;
+		}
+		if (packet.stream_index == videoStream) {
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(52, 21, 0)
+			err = avcodec_decode_video (w->codec, w->frame, &got_pic, packet.data, packet.size);
+#else
+			err = avcodec_decode_video2 (w->codec, w->frame, &got_pic, &packet);
+#endif
+		}
+		av_free_packet (&packet);
+		if (err < 0) {
+			return -1;
+		}
+		if (!got_pic) {
+			continue;
+		}
+		const int64_t pts = parse_pts_from_frame (w->frame);
+		const int64_t prefuzz = one_frame > 10 ? 1 : 0;
+		if (pts == AV_NOPTS_VALUE) {
+			return -1;
+		}
+		if (pts + prefuzz >= timestamp) {
+			return (pts - timestamp < one_frame) ? 0 : -1;
+		}
 	}
-
-	if (!want_quiet)
-		fprintf(stderr, "Index-seek: bail out. frame-distance too large.\n");
-	return -5;
+	return -1;
 }
 
-float index_progress = 0;
-
-static void report_idx_progress (const char *msg, float percent) {
-	static int lastval = 0;
-	if (!(OSD_mode & OSD_MSG)) return;
-	if (floorf (percent) == lastval) return; // also check msg?
-	lastval = floorf (percent);
-	index_progress = percent;
-	sprintf(OSD_msg, "%s%3.0f%%", msg, percent);
-	force_redraw = 1;
-}
+static int idx0_container_index (struct IndexWorker *w, int *max_kfi, int64_t *max_kfbd, int64_t *keyframecount) {
+	const AVStream *st = w->fmt->streams[videoStream];
+	const AVIndexEntry *ie = st->index_entries;
+	const int64_t n = st->nb_index_entries;
+	int64_t i, kf_pos = 0, keyframes = 0;
+	int kfi = 0;
 
-static int add_idx (int64_t ts, int64_t pos, uint8_t key, int _duration, AVRational tb) {
-	if (fcnt >= frames) {
-		++fcnt;
-		if (!want_quiet)
-			fprintf(stderr, "Index table Overflow: %"PRId64" / %"PRId64" frames.\n", fcnt, frames);
-		fidx = realloc (fidx, fcnt * sizeof(struct FrameIndex));
+	// the index must be complete, not just a list of keyframes (e.g. mkv cues)
+	if (!ie || n < 2 || n > frames || n < frames - MAX(2, frames / 200)) {
 		return -1;
 	}
-	report_idx_progress ("Pass 1: Scanning File:", 100.f * fcnt / frames);
 
-	fidx[fcnt].pkt_pts = ts;
-	fidx[fcnt].pkt_pos = pos;
-	fidx[fcnt].timestamp = av_rescale_q (fcnt, fr_Q, tb);
-	fidx[fcnt].key = key;
-
-	fidx[fcnt].frame_pts = -1;
-	fidx[fcnt].frame_pos = -1;
-	fidx[fcnt].seekpts = 0;
-	fidx[fcnt].seekpos = 0;
-#if 0 // DEBUG
-	if (fcnt < 50 || key)
-	printf("IDX %"PRId64" PKT-PTS %"PRId64"  TS %"PRId64"\n", fcnt, fidx[fcnt].pkt_pts, fidx[fcnt].timestamp);
+	for (i = 0; i < n; ++i) {
+		if (ie[i].pos < 0 || ie[i].timestamp == AV_NOPTS_VALUE) return -1;
+		if (i > 0 && ie[i].timestamp <= ie[i - 1].timestamp) return -1;
+#ifdef AVINDEX_DISCARD_FRAME
+		if (ie[i].flags & AVINDEX_DISCARD_FRAME) return -1;
 #endif
-	++fcnt;
-	return 0;
-}
+	}
 
-static int64_t keyframe_lookup_helper (const int64_t last, const int64_t ts) {
-	int64_t i;
-	assert(last < fcnt);
-	for (i = last; i >= 0; --i) {
-		if (!fidx[i].key) continue;
-		if (fidx[i].pkt_pts == AV_NOPTS_VALUE || fidx[i].frame_pts == AV_NOPTS_VALUE) {
-			continue;
+	if (want_verbose) {
+		printf("Building index from container's sample table (%"PRId64" entries).\n", n);
+	}
+
+	pthread_mutex_lock (&idx2_lock);
+	kfcnt = 0;
+	for (i = 0; i < n; ++i) {
+		fidx[i] = -1;
+		if (++kfi > *max_kfi) {
+			*max_kfi = kfi;
 		}
-		if (fidx[i].frame_pts <= ts) {
-			return i;
+		if (ie[i].flags & AVINDEX_KEYFRAME) {
+			struct KeyframeIndex *kf = kf_add (i);
+			if (!kf) {
+				break;
+			}
+			kf->pkt_pts = ie[i].timestamp;
+			kf->pkt_pos = ie[i].pos;
+			if (ie[i].pos - kf_pos > *max_kfbd) {
+				*max_kfbd = ie[i].pos - kf_pos;
+			}
+			kf_pos = ie[i].pos;
+			kfi = 0;
+			++keyframes;
+		}
+	}
+	fcnt = n;
+	idx1_cnt = n;
+	idx1_done = 1;
+	idx1_max_kfi = *max_kfi;
+	memset (idx_chunk, IDX_CHUNK_VERIFIED, (n + IDX2_CHUNK - 1) / IDX2_CHUNK);
+	__sync_synchronize ();
+	memset (idx_chunk + (n + IDX2_CHUNK - 1) / IDX2_CHUNK, IDX_CHUNK_FINAL,
+			idx_nchunks - (n + IDX2_CHUNK - 1) / IDX2_CHUNK);
+	pthread_mutex_unlock (&idx2_lock);
+
+	if (keyframes == 0 || keyframes != kfcnt) {
+		goto fail;
+	}
+
+	/* measure the PTS - DTS offset of keyframes, it must be constant */
+	int64_t pts_offset = AV_NOPTS_VALUE;
+	int s;
+	for (s = 0; s < IDX0_SAMPLES; ++s) {
+		// first keyframe, then random ones
+		const int64_t k = s == 0 ? 0 : (int64_t)(rand () / (RAND_MAX + 1.0) * kfcnt);
+		const int64_t good = w->keyframes;
+		if (idx2_verify_keyframe (w, k) || w->keyframes != good + 1) {
+			goto fail;
+		}
+		if (pts_offset == AV_NOPTS_VALUE) {
+			pts_offset = KF(k)->frame_pts - KF(k)->pkt_pts;
+		} else if (pts_offset != KF(k)->frame_pts - KF(k)->pkt_pts) {
+			if (want_verbose)
+				printf("Container index: keyframe PTS offset is not constant.\n");
+			goto fail;
+		}
+	}
+	if (pts_offset == AV_NOPTS_VALUE) {
+		goto fail;
+	}
+
+	/* sample table timestamps are DTS, pass 1 records the first PTS */
+	idx_first_pts = ie[0].timestamp + pts_offset;
+
+	for (i = 0; i < kfcnt; ++i) {
+		KF(i)->frame_pts = KF(i)->pkt_pts + pts_offset;
+		KF(i)->frame_pos = KF(i)->pkt_pos;
+	}
+
+	/* check that random frames can be reached */
+	for (s = 0; s < IDX0_SAMPLES; ++s) {
+		if (abort_indexing) goto fail;
+		i = s == 0 ? n - 1 : (int64_t)(rand () / (RAND_MAX + 1.0) * n);
+		if (idx0_check_frame (w, i, *max_kfi)) {
+			if (want_verbose)
+				printf("Container index: cannot seek to frame %"PRId64".\n", i);
+			goto fail;
 		}
 	}
+
+	*keyframecount = keyframes;
+	return 0;
+
+fail:
+	if (!want_quiet)
+		fprintf(stderr, "Container index is not usable, scanning file.\n");
+	pthread_mutex_lock (&idx2_lock);
+	memset (idx_chunk, IDX_CHUNK_PENDING, idx_nchunks);
+	idx1_cnt = 0;
+	idx1_done = 0;
+	idx1_max_kfi = 0;
+	fcnt = 0;
+	kfcnt = 0;
+	pthread_mutex_unlock (&idx2_lock);
+	*max_kfi = 0;
+	*max_kfbd = 0;
+	if (w->codec->codec->flush) {
+		avcodec_flush_buffers (w->codec);
+	}
+	av_seek_frame (w->fmt, videoStream, 0, AVSEEK_FLAG_BACKWARD);
 	return -1;
 }
 
-static int index_frames () {
+static int index_frames (const char *movie) {
+	struct IndexWorker demux;
 	AVPacket packet;
 	int      use_dts = 0;
 	int      error = 0;
@@ -750,11 +2503,41 @@ static int index_frames () {
 	int keyframe_interval = 0;
 	int64_t keyframe_byte_pos = 0;
 	int64_t keyframe_byte_distance = 0;
+	int64_t keyframecount = 0; // debug, info only.
+	uint8_t instant = 0;
 
 	AVRational const tb = pFormatCtx->streams[videoStream]->time_base;
 
-	if (!want_noindex && want_verbose) {
-		printf("Indexing Video...\n");
+	idx3_usec = 0;
+	idx3_calls = 0;
+	idx3_chunks = 0;
+
+	memset (&demux, 0, sizeof (struct IndexWorker));
+	if (!want_noindex) {
+		if (want_verbose) {
+			printf("Indexing Video...\n");
+		}
+		/* the display may decode frames (using pFormatCtx) while
+		 * the index is built, so the indexer needs its own context */
+		if (idx2_worker_open (&demux, movie, want_idxinline)) {
+			if (!want_quiet)
+				fprintf(stderr, "Index error: cannot open file.\n");
+			return -1;
+		}
+		instant = !idx0_container_index (&demux, &max_keyframe_interval, &keyframe_byte_distance, &keyframecount);
+		if (instant) {
+			idx2_worker_close (&demux);
+		} else {
+			idx2_start (movie);
+		}
+	}
+
+	idx1_kq_head = idx1_kq_len = 0;
+	idx1_inline_keyframes = 0;
+	idx1_inline_fail = NULL;
+	if (!want_noindex && !instant && want_idxinline) {
+		idx1_inline_fail = calloc (idx_nchunks, sizeof (uint8_t));
+		demux.codec->skip_frame = AVDISCARD_NONKEY;
 	}
 
 	pts_warn = 0;
@@ -764,10 +2547,14 @@ static int index_frames () {
 	 * -> discover max. keyframe distance
 	 * -> get PTS/DTS of every *packet*
 	 */
-	while (!want_noindex && av_read_frame (pFormatCtx, &packet) >= 0) {
+	while (!want_noindex && !instant && av_read_frame (demux.fmt, &packet) >= 0) {
 		if (abort_indexing) {
 			if (!want_quiet) fprintf(stderr, "Indexing aborted.\n");
 			av_free_packet (&packet);
+			idx2_stop_workers ();
+			idx2_worker_close (&demux);
+			free (idx1_inline_fail);
+			idx1_inline_fail = NULL;
 			return -1;
 		}
 #ifdef USE_DUP_PACKET
@@ -809,6 +2596,10 @@ static int index_frames () {
 			break;
 		}
 
+		if (key && idx1_inline_fail) {
+			idx1_inline_decode (&demux, &packet, kfcnt - 1);
+		}
+
 		if (key) {
 			int byte_distance =  packet.pos - keyframe_byte_pos;
 			keyframe_byte_pos = packet.pos;
@@ -831,7 +2622,7 @@ static int index_frames () {
 		}
 #if 1
 		if ((fcnt == 500 || fcnt == frames) && max_keyframe_interval == 1 &&
-				file_frame_offset == av_rescale_q (fidx[0].pkt_pts, tb, fr_Q)
+				file_frame_offset == av_rescale_q (idx_first_pts, tb, fr_Q)
 			 )
 		{
 			if (want_verbose)
@@ -842,28 +2633,50 @@ static int index_frames () {
 		if (key) {
 			keyframe_interval = 0;
 		}
+
+		// hand complete chunks to the verify-workers,
+		// after the all-keyframes test above was made.
+		if (fcnt > 500 && (fcnt % IDX2_CHUNK) == 0) {
+			idx1_publish (idx1_inline_fail ? idx1_inline_resolved () : fcnt,
+					max_keyframe_interval, 0, idx1_inline_fail);
+		}
 	}
 
 	pts_warn = 0;
 	int64_t i;
-	int64_t keyframecount = 0; // debug, info only.
 
-	if (want_noindex ||
+	if (instant) {
+		; // keyframes were verified by idx0_container_index()
+	}
+
+	else if (want_noindex ||
 			(
 			 (fcnt == 500 || fcnt == frames) && max_keyframe_interval == 1 &&
-			 file_frame_offset == av_rescale_q (fidx[0].pkt_pts, tb, fr_Q)
+			 file_frame_offset == av_rescale_q (idx_first_pts, tb, fr_Q)
 			)
 		 )
 	{
-		const int64_t pts_offset = fidx[0].pkt_pts;
-		for (i = 0; i < frames; ++i) {
-			fidx[i].key = 1;
-			fidx[i].pkt_pts = fidx[i].frame_pts = pts_offset + av_rescale_q (i, fr_Q, tb);
-			fidx[i].frame_pos = -1;
-			fidx[i].timestamp = av_rescale_q (file_frame_offset + i, fr_Q, tb);
-		}
+		idx2_stop_workers ();
+		idx2_worker_close (&demux);
+		free (idx1_inline_fail);
+		idx1_inline_fail = NULL;
+		/* direct mode: every frame is a keyframe, its PTS
+		 * and seek-point are computed from the frame-number */
+		idx_direct = 1;
+		idx_ts_offset = file_frame_offset;
+		kfcnt = 0;
 		fcnt = frames;
 		keyframecount = frames;
+		idx1_publish (fcnt, max_keyframe_interval, 1, NULL);
+		__sync_synchronize ();
+		memset (idx_chunk, IDX_CHUNK_FINAL, idx_nchunks);
+	}
+
+	else if (error) {
+		idx2_stop_workers ();
+		idx2_worker_close (&demux);
+		free (idx1_inline_fail);
+		idx1_inline_fail = NULL;
 	}
 
 	else
@@ -871,96 +2684,33 @@ static int index_frames () {
 	/* pass 2: verify keyframes
 	 * seek to [all] keyframe, decode one frame after
 	 * the keyframe and check *frame* PTS
+	 *
+	 * worker-threads have been verifying published chunks
+	 * meanwhile, the indexing thread now joins them.
 	 */
-
-	// TODO: Check if one could skip this process in part
-	// for [long] files where a pattern (constant offset) is detected.
-	for (i = 0; i < fcnt; ++i)
 	{
+		if (idx1_inline_fail) {
+			idx1_inline_drain (&demux);
+			demux.codec->skip_frame = AVDISCARD_DEFAULT;
+			avcodec_flush_buffers (demux.codec);
+		}
+		idx1_publish (fcnt, max_keyframe_interval, 1, idx1_inline_fail);
+		free (idx1_inline_fail);
+		idx1_inline_fail = NULL;
+		idx2_worker_run (&demux);
+		keyframecount = idx1_inline_keyframes + demux.keyframes + idx2_join ();
+		idx2_worker_close (&demux);
 		if (abort_indexing) {
 			if (!want_quiet) fprintf(stderr, "Indexing aborted.\n");
 			return -1;
 		}
-		if (!fidx[i].key) continue;
-
-		report_idx_progress ("Pass 2: Indexing Frames:", 100.f * i / fcnt);
-
-		int got_pic = 0;
-		int64_t pts = AV_NOPTS_VALUE;
-		if (av_seek_frame (pFormatCtx, videoStream, fidx[i].pkt_pts, AVSEEK_FLAG_BACKWARD)) {
-			fprintf(stderr, "IDX2: Seek failed.\n");
-			error |= 16;
-			break;
-		}
-		if (pCodecCtx->codec->flush) {
-			avcodec_flush_buffers (pCodecCtx);
-		}
-
-		int err = 0;
-		int bailout = 100;
-		while (!got_pic && --bailout) {
-
-			if ((err = av_read_frame (pFormatCtx, &packet)) < 0) {
-				if (err == AVERROR_EOF) {
-					fprintf(stderr, "IDX2: Read/Seek compensate for premature EOF\n");
-					fidx[i].key = 0;
-					av_free_packet (&packet);
-					break;
-				}
-				fprintf(stderr, "IDX2: Read failed @ %"PRId64" / %"PRId64".\n", i, fcnt);
-				error |= 32;
-				break;
-			}
-
-#ifdef USE_DUP_PACKET
-			if (av_dup_packet (&packet) < 0) {
-				if (!want_quiet)
-					fprintf(stderr, "Error: Cannot allocate video packet.\n");
-				break;
-			}
-#endif
-			if (packet.stream_index==videoStream) {
-#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(52, 21, 0)
-				err = avcodec_decode_video (pCodecCtx, pFrame, &got_pic, packet.data, packet.size);
-#else
-				err = avcodec_decode_video2 (pCodecCtx, pFrame, &got_pic, &packet);
-#endif
-			}
-			av_free_packet (&packet);
-
-			if (err < 0) {
-				break;
-			}
-
-			if (!got_pic) {
-				continue;
-			}
-
-			pts = parse_pts_from_frame (pFrame);
-
-			if (pts == AV_NOPTS_VALUE) {
-				err = -1;
-				if (!want_quiet)
-					fprintf(stderr, "No presentation timestamp (PTS) for video frame.\n");
-				break;
-			}
-		}
-
-		if (err < 0 || !bailout) continue;
-
-		fidx[i].frame_pts = pts;
-		fidx[i].frame_pos = av_frame_get_pkt_pos (pFrame);
-		if (pts != AV_NOPTS_VALUE) {
-#if 0 // DEBUG
-			printf("FN %"PRId64", PKT-PTS %"PRId64" FRM-PTS: %"PRId64"\n", i, fidx[i].pkt_pts, fidx[i].frame_pts);
-#endif
-			++keyframecount;
-		}
+		error |= idx2_error;
 	}
 
-	if (!want_quiet) {
-		const int64_t ppts_offset = fidx[0].pkt_pts;
-		const int64_t fpts_offset = fidx[0].frame_pts;
+	if (!want_quiet && !error) {
+		const int64_t ppts_offset = idx_first_pts;
+		const int64_t fpts_offset = idx_direct ? idx_first_pts :
+			(kfcnt > 0 && KF(0)->frame == 0) ? KF(0)->frame_pts : -1;
 		if (file_frame_offset != av_rescale_q (ppts_offset, tb, fr_Q)) {
 			fprintf(stderr, "FILE OFFSET MISMATCH %"PRId64" vs PKT-PTS: %"PRId64"\n",
 					file_frame_offset, av_rescale_q (ppts_offset, tb, fr_Q));
@@ -976,26 +2726,22 @@ static int index_frames () {
 
 	/* pass 3: Create Seek-Table
 	 * -> assign seek-[key]frame to every frame
+	 * (most chunks were completed during pass 2)
 	 */
-	for (i = 0; i < fcnt; ++i) {
+	pthread_mutex_lock (&idx2_lock);
+	idx1_max_kfi = max_keyframe_interval;
+	for (i = 0; i < idx_nchunks && !error; ++i) {
 		if (abort_indexing) {
+			pthread_mutex_unlock (&idx2_lock);
 			if (!want_quiet) fprintf(stderr, "Indexing aborted.\n");
 			return -1;
 		}
-		report_idx_progress ("Pass 3: Creating Index:", 100.f * i / fcnt);
-
-		int64_t kfi = keyframe_lookup_helper (MIN(fcnt - 1, i + 2 + max_keyframe_interval), fidx[i].timestamp);
-		if (kfi < 0) {
-			if (!want_quiet)
-				fprintf(stderr, "Cannot find keyframe for %"PRId64" %"PRId64"\n", i, fidx[i].timestamp);
-			fidx[i].seekpts = 0;
-			fidx[i].seekpos = 0;
-		} else {
-			//fprintf(stderr, "using keyframe %"PRId64" for %"PRId64"\n", kfi, fidx[i].timestamp);
-			fidx[i].seekpts = fidx[kfi].pkt_pts;
-			fidx[i].seekpos = fidx[kfi].frame_pos;
+		report_idx_progress ("Pass 3: Creating Index:", 100.f * i / idx_nchunks);
+		if (idx_chunk[i] == IDX_CHUNK_VERIFIED && idx3_finalize_chunk (i)) {
+			error |= 64;
 		}
 	}
+	pthread_mutex_unlock (&idx2_lock);
 
 #if 0 // DEBUG, TESTING
 	// check if byte-seeking is OK
@@ -1004,19 +2750,17 @@ static int index_frames () {
 	for (i = 0; i < 10 && byte_seek; ++i) {
 		int got_pic = 0;
 		int64_t n = random () % fcnt; // pick some random frames
-		if (fidx[n].seekpos < 0) {
+		if (seek_pos (n) < 0) {
 			byte_seek = 0;
 			printf("NOBYTE 1\n");
 			break;
 		}
-		if (av_seek_frame (pFormatCtx, videoStream, fidx[n].seekpos, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE) < 0) {
+		if (av_seek_frame (pFormatCtx, videoStream, seek_pos (n), AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE) < 0) {
 			byte_seek = 0;
 			printf("NOBYTE 2\n");
 			break;
 		}
-		if (pCodecCtx->codec->flush) {
-			avcodec_flush_buffers (pCodecCtx);
-		}
+		flush_decoder ();
 
 		int64_t pts = AV_NOPTS_VALUE;
 		while (!got_pic) {
@@ -1056,12 +2800,12 @@ static int index_frames () {
 			}
 			pts = parse_pts_from_frame (pFrame);
 		}
-		if (fidx[n].timestamp < pts || pts == AV_NOPTS_VALUE) {
+		if (frame_timestamp (n) < pts || pts == AV_NOPTS_VALUE) {
 			printf("NOBYTE 5\n");
 			byte_seek = 0;
 			break;
 		}
-		if (fidx[n].seekpts > pts) {
+		if (seek_pts (n) > pts) {
 			printf("NOBYTE 6\n");
 			byte_seek = 0;
 			break;
@@ -1072,16 +2816,14 @@ static int index_frames () {
 #if 0 // VERIFY -- DEBUG, TESTING
 	for (i = 0; i < fcnt; ++i) {
 		int got_pic = 0;
-		printf("\t\t %"PRId64" / %"PRId64"    %s   \r",i, fcnt, fidx[i].seekpos > 0 ? "B" : "P"); fflush (stdout);
+		printf("\t\t %"PRId64" / %"PRId64"    %s   \r",i, fcnt, seek_pos (i) > 0 ? "B" : "P"); fflush (stdout);
 		int64_t pts = AV_NOPTS_VALUE;
-		if (byte_seek && fidx[i].seekpos > 0) {
-			av_seek_frame (pFormatCtx, videoStream, fidx[i].seekpos, AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE);
+		if (byte_seek && seek_pos (i) > 0) {
+			av_seek_frame (pFormatCtx, videoStream, seek_pos (i), AVSEEK_FLAG_BACKWARD | AVSEEK_FLAG_BYTE);
 		} else {
-			av_seek_frame (pFormatCtx, videoStream, fidx[i].seekpts, AVSEEK_FLAG_BACKWARD);
-		}
-		if (pCodecCtx->codec->flush) {
-			avcodec_flush_buffers (pCodecCtx);
+			av_seek_frame (pFormatCtx, videoStream, seek_pts (i), AVSEEK_FLAG_BACKWARD);
 		}
+		flush_decoder ();
 		while (!got_pic) {
 
 			if (av_read_frame (pFormatCtx, &packet) < 0) {
@@ -1116,9 +2858,9 @@ static int index_frames () {
 				break;
 			}
 		}
-		if (fidx[i].timestamp < pts) {
+		if (frame_timestamp (i) < pts) {
 			printf("FAIL! fn:%d  want: %"PRId64", seek: %"PRId64" got:%"PRId64"\n",
-					i, fidx[i].timestamp, fidx[i].seekpts, pts);
+					i, frame_timestamp (i), seek_pts (i), pts);
 		}
 	}
 #endif
@@ -1150,19 +2892,317 @@ static int index_frames () {
 		printf("max keyframe distance: %.1f kBytes\n",
 				keyframe_byte_distance / 1024.f);
 		printf("Seek by %s\n", byte_seek ? "Byte" : "PTS");
+		printf("Pass 3: %"PRId64" chunks finalized in %.2f ms (%"PRId64" attempts, %.2f us/frame)\n",
+				idx3_chunks, idx3_usec / 1000.0, idx3_calls,
+				fcnt > 0 ? (double)idx3_usec / fcnt : 0.0);
 	}
 
-	av_seek_frame (pFormatCtx, videoStream, 0, AVSEEK_FLAG_BACKWARD);
-	if (pCodecCtx->codec->flush) {
-		avcodec_flush_buffers (pCodecCtx);
-	}
 	if (!error) {
+		__sync_synchronize ();
 		scan_complete = 1;
+	} else {
+		// frames of chunks that were already published are no longer valid
+		pthread_mutex_lock (&idx2_lock);
+		memset (idx_chunk, IDX_CHUNK_PENDING, idx_nchunks);
+		pthread_mutex_unlock (&idx2_lock);
+		force_redraw = 1;
 	}
 	return error;
 }
 
+//--------------------------------------------
+// persistent index cache
+//--------------------------------------------
+
+/* the index of every file that was successfully scanned is saved
+ * to $XDG_CACHE_HOME/xjadeo/ and re-used if neither the file
+ * (size, mtime, content hash) nor the index settings changed.
+ */
+
+#ifndef PATH_MAX
+#define PATH_MAX 1024
+#endif
+
+#ifdef PLATFORM_WINDOWS
+#define DIRSEP '\\'
+#define PATHSEP "\\"
+#else
+#define DIRSEP '/'
+#define PATHSEP "/"
+#endif
+
+#define IDXCACHE_VERSION (2)
+#define IDXCACHE_HASHLEN (65536)
+
+struct IndexCacheHeader {
+	char     magic[8];
+	uint32_t version;
+	uint32_t entry_size;
+	int64_t  file_size;
+	int64_t  file_mtime;
+	uint64_t content_hash;
+	int64_t  frames;
+	int64_t  fcnt;
+	int64_t  kfcnt;
+	int64_t  first_pts;
+	int64_t  ts_offset;
+	int64_t  file_frame_offset;
+	int32_t  seek_threshold;
+	int32_t  keyframe_limit;
+	uint8_t  byte_seek;
+	uint8_t  noindex;
+	uint8_t  genpts;
+	uint8_t  direct;
+	uint32_t path_len;
+};
+
+static uint64_t fnv1a64 (uint64_t h, const uint8_t *data, size_t len) {
+	size_t i;
+	for (i = 0; i < len; ++i) {
+		h ^= data[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static void idxcache_mkpath (const char *dir) {
+	char tmp[PATH_MAX];
+	char *p;
+	snprintf (tmp, sizeof(tmp), "%s", dir);
+	for (p = tmp + 1; *p; ++p) {
+		if (*p != DIRSEP) continue;
+		*p = 0;
+#ifdef PLATFORM_WINDOWS
+		mkdir (tmp);
+#else
+		mkdir (tmp, 0755);
+#endif
+		*p = DIRSEP;
+	}
+#ifdef PLATFORM_WINDOWS
+	mkdir (tmp);
+#else
+	mkdir (tmp, 0755);
+#endif
+}
+
+static int idxcache_dir (char *dir, size_t len) {
+	const char *xdg = getenv ("XDG_CACHE_HOME");
+	if (xdg && strlen (xdg) + 8 < len) {
+		sprintf (dir, "%s" PATHSEP "xjadeo", xdg);
+		return 0;
+	}
+#ifdef PLATFORM_WINDOWS
+	const char *appdata = getenv ("LOCALAPPDATA");
+	if (appdata && strlen (appdata) + 8 < len) {
+		sprintf (dir, "%s" PATHSEP "xjadeo", appdata);
+		return 0;
+	}
+#elif defined PLATFORM_OSX
+	const char *home = getenv ("HOME");
+	if (home && strlen (home) + 23 < len) {
+		sprintf (dir, "%s/Library/Caches/xjadeo", home);
+		return 0;
+	}
+#else
+	const char *home = getenv ("HOME");
+	if (home && strlen (home) + 16 < len) {
+		sprintf (dir, "%s/.cache/xjadeo", home);
+		return 0;
+	}
+#endif
+	return -1;
+}
+
+/* hash file-size and the first and last 64kBytes of the file */
+static uint64_t idxcache_content_hash (const char *path, int64_t size) {
+	uint8_t *buf;
+	size_t rd;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	FILE *f = fopen (path, "rb");
+	if (!f) return 0;
+	buf = malloc (IDXCACHE_HASHLEN);
+	if (!buf) {
+		fclose (f);
+		return 0;
+	}
+	h = fnv1a64 (h, (const uint8_t *)&size, sizeof (int64_t));
+	rd = fread (buf, 1, IDXCACHE_HASHLEN, f);
+	h = fnv1a64 (h, buf, rd);
+	if (size > 2 * IDXCACHE_HASHLEN && !fseeko (f, (off_t)(size - IDXCACHE_HASHLEN), SEEK_SET)) {
+		rd = fread (buf, 1, IDXCACHE_HASHLEN, f);
+		h = fnv1a64 (h, buf, rd);
+	}
+	free (buf);
+	fclose (f);
+	return h;
+}
+
+/* resolve absolute path, fill in header for the current file and
+ * settings, and find the name of the cache-file for it */
+static int idxcache_prepare (const char *movie, struct IndexCacheHeader *hdr, char *abspath, char *cachefile) {
+	struct stat st;
+	char dir[PATH_MAX];
+
+#ifdef PLATFORM_WINDOWS
+	if (!_fullpath (abspath, movie, PATH_MAX)) return -1;
+#else
+	if (!realpath (movie, abspath)) return -1;
+#endif
+	if (stat (abspath, &st)) return -1;
+	if (idxcache_dir (dir, sizeof(dir))) return -1;
+
+	const uint64_t ph = fnv1a64 (0xcbf29ce484222325ULL, (const uint8_t *)abspath, strlen (abspath));
+	if (strlen (dir) + 24 >= PATH_MAX) return -1;
+	sprintf (cachefile, "%s" PATHSEP "%016"PRIx64".idx", dir, ph);
+
+	memset (hdr, 0, sizeof (struct IndexCacheHeader));
+	memcpy (hdr->magic, "XJIDX", 5);
+	hdr->version           = IDXCACHE_VERSION;
+	hdr->entry_size        = sizeof (struct KeyframeIndex);
+	hdr->file_size         = st.st_size;
+	hdr->file_mtime        = st.st_mtime;
+	hdr->content_hash      = idxcache_content_hash (abspath, st.st_size);
+	hdr->frames            = frames;
+	hdr->file_frame_offset = file_frame_offset;
+	hdr->keyframe_limit    = keyframe_interval_limit;
+	hdr->noindex           = want_noindex ? 1 : 0;
+	hdr->genpts            = want_genpts ? 1 : 0;
+	hdr->path_len          = strlen (abspath);
+	return 0;
+}
+
+static int idxcache_load (const char *movie) {
+	struct IndexCacheHeader want, have;
+	char abspath[PATH_MAX];
+	char cachefile[PATH_MAX];
+	char storedpath[PATH_MAX];
+	FILE *f;
+	int rv = -1;
+
+	if (idxcache_prepare (movie, &want, abspath, cachefile)) return -1;
+	if (!(f = fopen (cachefile, "rb"))) return -1;
+
+	if (fread (&have, sizeof (struct IndexCacheHeader), 1, f) != 1) goto out;
+	if (memcmp (have.magic, want.magic, sizeof (have.magic))
+			|| have.version != want.version
+			|| have.entry_size != want.entry_size
+			|| have.file_size != want.file_size
+			|| have.file_mtime != want.file_mtime
+			|| have.content_hash != want.content_hash
+			|| have.frames != want.frames
+			|| have.file_frame_offset != want.file_frame_offset
+			|| have.keyframe_limit != want.keyframe_limit
+			|| have.noindex != want.noindex
+			|| have.genpts != want.genpts
+			|| have.path_len != want.path_len
+			|| have.fcnt < 1 || have.fcnt > frames
+			|| have.kfcnt < 0 || have.kfcnt > have.fcnt
+		 )
+	{
+		if (want_verbose)
+			printf("Index cache is outdated.\n");
+		goto out;
+	}
+	if (fread (storedpath, have.path_len, 1, f) != 1) goto out;
+	if (memcmp (storedpath, abspath, have.path_len)) goto out;
+	if (!have.direct && fread (fidx, sizeof (int32_t), have.fcnt, f) != have.fcnt) goto out;
+
+	int64_t k;
+	kfcnt = 0;
+	for (k = 0; k < have.kfcnt; ++k) {
+		struct KeyframeIndex *kf = kf_add (0);
+		if (!kf || fread (kf, sizeof (struct KeyframeIndex), 1, f) != 1) {
+			kfcnt = 0;
+			goto out;
+		}
+		// keyframes must be in order, kf_find() bisects them
+		if (kf->frame < 0 || kf->frame >= have.fcnt || (k > 0 && kf->frame <= KF(k - 1)->frame)) {
+			kfcnt = 0;
+			goto corrupt;
+		}
+	}
+	if (!have.direct) {
+		for (k = 0; k < have.fcnt; ++k) {
+			if (fidx[k] < -1 || fidx[k] >= have.kfcnt) {
+				kfcnt = 0;
+				goto corrupt;
+			}
+		}
+	}
+
+	fcnt              = have.fcnt;
+	idx_first_pts     = have.first_pts;
+	idx_ts_offset     = have.ts_offset;
+	idx_direct        = have.direct;
+	seek_threshold    = have.seek_threshold;
+	byte_seek         = have.byte_seek;
+	file_frame_offset = have.file_frame_offset;
+	rv = 0;
+
+	if (want_verbose)
+		printf("Loaded index from cache: %s\n", cachefile);
+	goto out;
+corrupt:
+	if (!want_quiet)
+		fprintf(stderr, "Index cache is corrupt, ignored: %s\n", cachefile);
+out:
+	fclose (f);
+	return rv;
+}
+
+static void idxcache_save (const char *movie) {
+	struct IndexCacheHeader hdr;
+	char abspath[PATH_MAX];
+	char cachefile[PATH_MAX];
+	char tmpfile[PATH_MAX + 4];
+	char dir[PATH_MAX];
+	FILE *f;
+
+	if (idxcache_prepare (movie, &hdr, abspath, cachefile)) return;
+	if (idxcache_dir (dir, sizeof(dir))) return;
+	idxcache_mkpath (dir);
+
+	hdr.fcnt           = fcnt;
+	hdr.kfcnt          = kfcnt;
+	hdr.first_pts      = idx_first_pts;
+	hdr.ts_offset      = idx_ts_offset;
+	hdr.direct         = idx_direct;
+	hdr.seek_threshold = seek_threshold;
+	hdr.byte_seek      = byte_seek;
+
+	sprintf (tmpfile, "%s.tmp", cachefile);
+	if (!(f = fopen (tmpfile, "wb"))) {
+		if (!want_quiet)
+			fprintf(stderr, "Cannot write index cache '%s': %s\n", tmpfile, strerror (errno));
+		return;
+	}
+	int ok = fwrite (&hdr, sizeof (struct IndexCacheHeader), 1, f) == 1
+		&& fwrite (abspath, hdr.path_len, 1, f) == 1
+		&& (idx_direct || fwrite (fidx, sizeof (int32_t), fcnt, f) == fcnt);
+	int64_t k;
+	for (k = 0; ok && k < kfcnt; k += KF_BLOCK) {
+		const size_t n = MIN(KF_BLOCK, kfcnt - k);
+		ok = fwrite (KF(k), sizeof (struct KeyframeIndex), n, f) == n;
+	}
+	if (!ok) {
+		fclose (f);
+		unlink (tmpfile);
+		return;
+	}
+	fclose (f);
+#ifdef PLATFORM_WINDOWS
+	unlink (cachefile);
+#endif
+	if (rename (tmpfile, cachefile)) {
+		unlink (tmpfile);
+	} else if (want_verbose) {
+		printf("Saved index to cache: %s\n", cachefile);
+	}
+}
+
 static void *index_run (void *arg) {
+	char *movie = (char *)arg;
 	OSD_mode |= OSD_MSG | OSD_IDXNFO;
 	OSD_mode &= ~(OSD_EQ | OSD_OFFF | OSD_OFFS);
 	sprintf(OSD_msg, "Indexing. Please wait.");
@@ -1172,7 +3212,14 @@ static void *index_run (void *arg) {
 	osd_vtc_oob  = -1;
 	index_progress = 0;
 	force_redraw = 1;
-	if (!index_frames()) {
+	if (want_idxcache && !want_noindex && !idxcache_load (movie)) {
+		__sync_synchronize ();
+		scan_complete = 1;
+		OSD_mode &= ~OSD_MSG;
+	} else if (!index_frames (movie)) {
+		if (want_idxcache && !want_noindex) {
+			idxcache_save (movie);
+		}
 		OSD_mode &= ~OSD_MSG;
 	} else {
 		OSD_mode |= OSD_BOX;
@@ -1181,6 +3228,7 @@ static void *index_run (void *arg) {
 	OSD_mode &= ~OSD_IDXNFO;
 	index_progress = -1;
 	force_redraw = 1;
+	free (movie);
 	pthread_exit (NULL);
 	return (NULL);
 }
@@ -1201,8 +3249,10 @@ static int start_index_thread (void) {
 		if (!want_quiet) fprintf(stderr, "Indexing thread is still active. Forcing Re-start.\n");
 		cancel_index_thread ();
 	}
-	if (pthread_create (&index_thread, NULL, index_run, NULL)) {
+	char *movie = strdup (current_file);
+	if (pthread_create (&index_thread, NULL, index_run, movie)) {
 		if (!want_quiet) fprintf(stderr, "Cannot launch index thread.\n");
+		free (movie);
 		return -1;
 	}
 	thread_active = 1;
@@ -1240,7 +3290,9 @@ int open_movie (char* file_name) {
 	}
 
 	OSD_mode &= ~OSD_MSG;
+	readahead_stop ();
 	reset_index ();
+	frame_cache_free ();
 
 	/* set some defaults, in case open fails, the main-loop
 	 * will still get some consistent data
@@ -1378,16 +3430,19 @@ int open_movie (char* file_name) {
 	}
 
 	one_frame = av_rescale_q (1, fr_Q, av_stream->time_base);
+	idx_tb = av_stream->time_base;
 
 	if (pFormatCtx->start_time != AV_NOPTS_VALUE) {
 		file_frame_offset = (int64_t) rint (framerate * (double) pFormatCtx->start_time / (double) AV_TIME_BASE);
 	}
 
-	fidx = malloc (frames * sizeof(struct FrameIndex));
+	fidx = malloc (frames * sizeof(int32_t));
+	kfblocks = (frames + KF_BLOCK - 1) / KF_BLOCK;
+	kfidx = calloc (kfblocks, sizeof (struct KeyframeIndex *));
+	idx_nchunks = (frames + IDX2_CHUNK - 1) / IDX2_CHUNK;
+	idx_chunk = calloc (idx_nchunks, sizeof (uint8_t));
 	for (i = 0; i < frames; ++i) {
-		fidx[i].pkt_pts = -1;
-		fidx[i].pkt_pos = -1;
-		fidx[i].key = 0;
+		fidx[i] = -1;
 	}
 
 	// recalc offset with new framerate
@@ -1448,6 +3503,9 @@ int open_movie (char* file_name) {
 		pFormatCtx->flags |= AVFMT_FLAG_GENPTS;
 #endif
 
+	source_width  = movie_width;
+	source_height = movie_height;
+
 	if (!want_quiet) {
 		fprintf(stderr, "display size: %ix%i px\n", movie_width, movie_height);
 	}
@@ -1462,6 +3520,12 @@ int open_movie (char* file_name) {
 		return -1;
 	}
 
+#ifdef FF_THREAD_FRAME
+	// 0: let libavcodec pick the number of threads
+	pCodecCtx->thread_count = decoder_threads;
+	pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+#endif
+
 	// Open codec
 	if (avcodec_open2(pCodecCtx, pCodec, NULL) < 0) {
 		if (!want_quiet)
@@ -1472,6 +3536,17 @@ int open_movie (char* file_name) {
 		return -1;
 	}
 
+#ifdef FF_THREAD_FRAME
+	decoder_delay = (pCodecCtx->active_thread_type & FF_THREAD_FRAME) ? pCodecCtx->thread_count : 0;
+	if (want_verbose) {
+		printf("decoder threads: %d (%s)\n", pCodecCtx->thread_count,
+				(pCodecCtx->active_thread_type & FF_THREAD_FRAME) ? "frame" :
+				(pCodecCtx->active_thread_type & FF_THREAD_SLICE) ? "slice" : "none");
+	}
+#else
+	decoder_delay = 0;
+#endif
+
 	pFrame=av_frame_alloc();
 	if (pFrame == NULL) {
 		if (!want_quiet)
@@ -1654,7 +3729,12 @@ void display_frame (int64_t timestamp, int force_update) {
 	}
 #endif
 
-	if (!scan_complete || !current_file) {
+	if (current_file && !scan_complete) {
+		// let the indexer prefer the region around the sync position
+		idx_priority = want_ignstart ? timestamp + file_frame_offset : timestamp;
+	}
+
+	if (!current_file || !index_ready (want_ignstart ? timestamp + file_frame_offset : timestamp)) {
 		OSD_frame[0] = '\0';
 		int need_redisplay = force_update;
 		if (OSD_mode&OSD_SMPTE) {
@@ -1744,28 +3824,33 @@ void display_frame (int64_t timestamp, int force_update) {
 #endif
 	}
 
-	if (pFrameFMT && !seek_frame (&packet, timestamp)) {
-		/* Convert the image from its native format to FMT */
-		// TODO: this can be done once per Video output.
-		int dstStride[8] = {0,0,0,0,0,0,0,0};
-		switch (render_fmt) {
-			case AV_PIX_FMT_RGBA32:
-			case AV_PIX_FMT_BGRA32:
-				dstStride[0] = movie_width*4;
-				break;
-			case AV_PIX_FMT_BGR24:
-				dstStride[0] = movie_width*3;
-				break;
-			case AV_PIX_FMT_UYVY422:
-				dstStride[0] = movie_width*2;
-				break;
-			case AV_PIX_FMT_YUV420P:
-			default:
-				dstStride[0] = movie_width;
-				dstStride[1] = movie_width/2;
-				dstStride[2] = movie_width/2;
+	if (pFrameFMT && force_update && displaying_valid_frame
+			&& timestamp == pristine_frame && render_is_current ()) {
+		// neither the frame, the OSD nor the window changed
+		++redraws_skipped;
+		return;
+	}
+
+	if (pFrameFMT && !pristine_get (timestamp, buffer)) {
+		// same frame, only re-composite the OSD
+		++redraws_recomposited;
+		displaying_valid_frame = 1;
+		if (!splashed) {
+			splash(buffer);
+		}
+		render_buffer (buffer);
+	}
+	else if (pFrameFMT && !frame_cache_get (timestamp, buffer)) {
+		pristine_put (timestamp);
+		displaying_valid_frame = 1;
+		if (!splashed) {
+			splash(buffer);
 		}
-		sws_scale (pSWSCtx, (const uint8_t * const*)pFrame->data, pFrame->linesize, 0, pCodecCtx->height, pFrameFMT->data, dstStride);
+		render_buffer (buffer);
+	}
+	else if (pFrameFMT && !decode_frame (&packet, timestamp, pFrameFMT->data)) {
+		frame_cache_put (timestamp, buffer);
+		pristine_put (timestamp);
 		displaying_valid_frame = 1;
 		if (!splashed) {
 			splash(buffer);
@@ -1777,29 +3862,41 @@ void display_frame (int64_t timestamp, int force_update) {
 		// seek failed of no format
 		if (pFrameFMT && want_debug)
 			printf("DEBUG: frame seek unsucessful.\n");
+		pristine_frame = -1;
 		render_empty_frame (force_update || displaying_valid_frame, 0);
 		displaying_valid_frame = 0;
-		last_decoded_pts = -1;
-		last_decoded_frameno = -1;
 	}
 }
 
 int close_movie () {
+	int64_t i;
 	if (current_file)
 		free (current_file);
 	current_file=NULL;
 
+	readahead_stop();
 	cancel_index_thread();
 	free (fidx);
 	fidx = NULL;
+	for (i = 0; i < kfblocks; ++i) {
+		free (kfidx[i]);
+	}
+	free (kfidx);
+	kfidx = NULL;
+	kfblocks = 0;
+	free (idx_chunk);
+	idx_chunk = NULL;
+	idx_nchunks = 0;
+	frame_cache_free ();
 
 	if (!pFrameFMT) return -1;
-	// Free the software scaler
-	sws_freeContext (pSWSCtx);
+	// the software scaler is owned by the sws cache
+	pSWSCtx = NULL;
 
 	// Free the formatted image
-	if (buffer) free (buffer);
-	buffer=NULL;
+	pristine_reset ();
+	free (moviebuffer);
+	buffer = moviebuffer = NULL;
 	if (pFrameFMT)
 		av_free (pFrameFMT);
 	pFrameFMT=NULL;
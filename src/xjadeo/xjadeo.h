@@ -140,6 +140,11 @@ int try_next_vidoutmode(int user_req);
 void splash (uint8_t *mybuffer);
 
 void render_buffer (uint8_t *mybuffer);
+int  render_is_current (void);
+void pacing_frame_presented (void);
+void pacing_frame_skipped (void);
+void pacing_reset (void);
+void pacing_stats (uint64_t *presented, uint64_t *skipped, double *interval, double *jitter);
 void handle_X_events (void);
 void Xresize (unsigned int x, unsigned int y);
 void Xfullscreen (int a);
@@ -186,6 +191,12 @@ void avinit (void);
 void init_moviebuffer(void);
 void event_loop(void);
 size_t video_buffer_size();
+void redirect_moviebuffer (uint8_t *buf);
+void sws_cache_free (void);
+void redraw_stats (uint64_t *recomposited, uint64_t *skipped);
+void syncsmooth_stats (int *locked, double *err, double *avg, double *peak, double *rate, uint64_t *resets);
+void conversion_stats (uint64_t *frames, int64_t *last, int64_t *avg, int64_t *peak, int *slices);
+void frame_cache_stats (uint64_t *hits, uint64_t *misses, int *used, int *size);
 
 
 /* common_jack.c */
@@ -253,6 +264,7 @@ void jackt_toggle();
 
 /* ltc-jack.c function prototypes */
 int64_t ltc_poll_frame (void);
+void ltc_stats (uint64_t *decoded, uint64_t *dropped);
 void open_ltcjack(char *autoconnect);
 void close_ltcjack(void);
 int ltcjack_connected(void);